@@ -62,64 +62,94 @@ void WarningManager::queryWarnings(const QString &statusFilter) {
     }
 }
 
+void WarningManager::appendWarningPage(const nlohmann::json& warnings) {
+    for (const auto& item : warnings) {
+        QVariantMap map;
+        // order_id 按协议为字符串，兼容数字
+        std::string orderId = item.contains("order_id") && item["order_id"].is_number()
+            ? std::to_string(item["order_id"].get<long long>())
+            : item.value("order_id", "");
+        map.insert("order_id", QString::fromStdString(orderId));
+        map.insert("symbol", QString::fromStdString(item.value("symbol", "")));
+
+        std::string wType = item.value("warning_type", "");
+        if (wType.empty()) wType = item.value("type", "");
+        map.insert("type", QString::fromStdString(wType));
+
+        // Add Contract Name
+        std::string symbol = item.value("symbol", "");
+        QString qSymbol = QString::fromStdString(symbol);
+        if (!pendingSymbols_.contains(qSymbol) && !qSymbol.isEmpty()) {
+            pendingSymbols_.append(qSymbol);
+        }
+        QString contractName = qSymbol; // Default to code
+
+        for (const auto& entry : RAW_CONTRACT_DATA) {
+            if (entry.code == symbol) {
+                contractName = QString::fromStdString(entry.name);
+                break;
+            }
+        }
+        map.insert("contract_name", contractName);
+
+        if (item.contains("max_price") && item["max_price"].is_number()) map.insert("max_price", item["max_price"].get<double>());
+        if (item.contains("min_price") && item["min_price"].is_number()) map.insert("min_price", item["min_price"].get<double>());
+        if (item.contains("trigger_time") && item["trigger_time"].is_string()) map.insert("trigger_time", QString::fromStdString(item["trigger_time"].get<std::string>()));
+
+        // 解析触发状态
+        std::string status = item.value("status", "active");
+        map.insert("status", QString::fromStdString(status));
+
+        warningList_.append(QVariant(map));
+    }
+}
+
 void WarningManager::handleResponse(const std::string& type, bool success, const std::string& message, const nlohmann::json& j) {
     qDebug() << "[WarningManager] handleResponse:" << QString::fromStdString(type) << "success:" << success;
     
     if (type == "query_warnings") {
         if (success) {
-            // 按照 protocol.md: data.warnings 是数组，data.total 是总数
-            nlohmann::json warnings;
+            // 按照 protocol.md: data.warnings 是当前页的数组，data.has_more 表示后面还有页，
+            // 最后一页带 data.total。不分页的旧服务器只有一页且不带 page/has_more。
+            nlohmann::json warnings = nlohmann::json::array();
+            int page = 0;
+            bool hasMore = false;
             if (j.contains("data")) {
-                if (j["data"].contains("warnings") && j["data"]["warnings"].is_array()) {
-                    warnings = j["data"]["warnings"];
-                } else if (j["data"].is_array()) {
+                const auto& data = j["data"];
+                if (data.contains("warnings") && data["warnings"].is_array()) {
+                    warnings = data["warnings"];
+                } else if (data.is_array()) {
                     // 兼容旧格式
-                    warnings = j["data"];
+                    warnings = data;
                 }
-            }
-            
-            warningList_.clear();
-            QStringList symbolsToSubscribe;
-            for (const auto& item : warnings) {
-                QVariantMap map;
-                map.insert("order_id", QString::fromStdString(item.value("order_id", "")));
-                map.insert("symbol", QString::fromStdString(item.value("symbol", "")));
-                
-                std::string wType = item.value("warning_type", "");
-                if (wType.empty()) wType = item.value("type", "");
-                map.insert("type", QString::fromStdString(wType));
-
-                // Add Contract Name
-                std::string symbol = item.value("symbol", "");
-                QString qSymbol = QString::fromStdString(symbol);
-                if (!symbolsToSubscribe.contains(qSymbol) && !qSymbol.isEmpty()) {
-                    symbolsToSubscribe.append(qSymbol);
+                if (data.is_object()) {
+                    page = data.value("page", 0);
+                    hasMore = data.value("has_more", false);
                 }
-                QString contractName = qSymbol; // Default to code
-                
-                for (const auto& entry : RAW_CONTRACT_DATA) {
-                    if (entry.code == symbol) {
-                        contractName = QString::fromStdString(entry.name);
-                        break;
-                    }
-                }
-                map.insert("contract_name", contractName);
-
-                if (item.contains("max_price")) map.insert("max_price", item["max_price"].get<double>());
-                if (item.contains("min_price")) map.insert("min_price", item["min_price"].get<double>());
-                if (item.contains("trigger_time")) map.insert("trigger_time", QString::fromStdString(item["trigger_time"].get<std::string>()));
-                
-                // 解析触发状态
-                std::string status = item.value("status", "active");
-                map.insert("status", QString::fromStdString(status));
-                
-                warningList_.append(QVariant(map));
             }
-            qDebug() << "[WarningManager] Loaded" << warningList_.size() << "warnings";
+
+            std::string requestId = j.value("request_id", "");
+            if (page == 0) {
+                // 新一轮查询的首页：清空旧列表
+                pendingQueryId_ = requestId;
+                pendingSymbols_.clear();
+                warningList_.clear();
+            } else if (requestId != pendingQueryId_) {
+                // 已被更新的查询取代，丢弃过期的分页
+                return;
+            }
+
+            appendWarningPage(warnings);
+            qDebug() << "[WarningManager] Loaded page" << page << ", total" << warningList_.size() << "warnings";
             emit warningListChanged();
-            // 始终发送订阅请求（即使列表为空，也需要退订不再需要的合约）
-            emit subscribeRequest(symbolsToSubscribe);
+
+            if (!hasMore) {
+                pendingQueryId_.clear();
+                // 始终发送订阅请求（即使列表为空，也需要退订不再需要的合约）
+                emit subscribeRequest(pendingSymbols_);
+            }
         } else {
+            pendingQueryId_.clear();
             emit operationResult(false, QString::fromStdString(message));
         }
     } else if (type == "add_warning") {
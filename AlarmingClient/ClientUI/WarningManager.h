@@ -30,7 +30,13 @@ public:
     void handleResponse(const std::string& type, bool success, const std::string& message, const nlohmann::json& j);
 
 private:
+    // query_warnings 的结果按页分多帧返回，逐页追加到 warningList_
+    void appendWarningPage(const nlohmann::json& warnings);
+
     FuturesClient* client_ = nullptr;
     QString currentUsername_;
     QVariantList warningList_;
+
+    std::string pendingQueryId_;         // 正在接收分页结果的查询请求 ID
+    QStringList pendingSymbols_;         // 已收到的各页中出现的合约代码
 };
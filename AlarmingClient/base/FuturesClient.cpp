@@ -1,6 +1,8 @@
 ﻿#include "FuturesClient.h"
 #include <cstring>
 #include <chrono>
+#include <algorithm>
+#include <zlib.h>
 
 // 日志输出宏 - 在 Qt 环境下使用 qDebug，否则使用 std::cout
 #ifdef QT_CORE_LIB
@@ -15,45 +17,139 @@
 #define LOG_ERROR(msg) std::cerr << "[ERROR] " << msg << std::endl
 #endif
 
+// ==========================================
+// 消息体压缩 (v4_flag_deflate)
+// ==========================================
+
+namespace {
+
+const std::size_t raw_length_bytes = 4;  // 压缩消息体开头的原始长度字段
+
+/**
+ * @brief 压缩消息体
+ * 输出 4 字节大端原始长度 + zlib 数据。压缩失败或压缩后不比原来小时返回 false。
+ */
+bool compress_body(const std::string& raw, std::string& out) {
+    uLongf packed_length = compressBound(static_cast<uLong>(raw.size()));
+    out.resize(raw_length_bytes + packed_length);
+    for (std::size_t k = 0; k < raw_length_bytes; ++k) {
+        out[k] = static_cast<char>((raw.size() >> (8 * (raw_length_bytes - 1 - k))) & 0xFF);
+    }
+    int rc = compress2(reinterpret_cast<Bytef*>(&out[raw_length_bytes]), &packed_length,
+        reinterpret_cast<const Bytef*>(raw.data()), static_cast<uLong>(raw.size()), Z_BEST_SPEED);
+    if (rc != Z_OK || raw_length_bytes + packed_length >= raw.size()) {
+        return false;
+    }
+    out.resize(raw_length_bytes + packed_length);
+    return true;
+}
+
+/**
+ * @brief 解压消息体
+ * 原始长度超过 ChatMessage::max_frame_length() 或数据损坏时返回 false。
+ */
+bool decompress_body(const char* data, std::size_t length, std::string& out) {
+    if (length < raw_length_bytes) return false;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    std::size_t raw_length = 0;
+    for (std::size_t k = 0; k < raw_length_bytes; ++k) {
+        raw_length = (raw_length << 8) | p[k];
+    }
+    if (raw_length > ChatMessage::max_frame_length()) return false;
+
+    out.resize(raw_length);
+    uLongf out_length = static_cast<uLongf>(raw_length);
+    int rc = uncompress(reinterpret_cast<Bytef*>(&out[0]), &out_length,
+        reinterpret_cast<const Bytef*>(data + raw_length_bytes), static_cast<uLong>(length - raw_length_bytes));
+    return rc == Z_OK && out_length == raw_length;
+}
+
+} // namespace
+
 // ==========================================
 // ChatMessage 类实现
 // ==========================================
 
-ChatMessage::ChatMessage() : body_length_(0) {
+std::size_t ChatMessage::max_frame_length_ = 16 * 1024 * 1024;
+
+ChatMessage::ChatMessage() : data_(header_length), body_length_(0), version_(frame_v3), flags_(0) {
 }
 
-const char* ChatMessage::data() const { return data_; }
-char* ChatMessage::data() { return data_; }
+const char* ChatMessage::data() const { return data_.data(); }
+char* ChatMessage::data() { return data_.data(); }
 
 std::size_t ChatMessage::length() const { return header_length + body_length_; }
 
-const char* ChatMessage::body() const { return data_ + header_length; }
-char* ChatMessage::body() { return data_ + header_length; }
+const char* ChatMessage::body() const { return data_.data() + header_length; }
+char* ChatMessage::body() { return data_.data() + header_length; }
 
 std::size_t ChatMessage::body_length() const { return body_length_; }
 
 void ChatMessage::body_length(std::size_t new_length) {
     body_length_ = new_length;
-    if (body_length_ > max_body_length)
-        body_length_ = max_body_length;
+    if (body_length_ > max_length_for(version_))
+        body_length_ = max_length_for(version_);
+    data_.resize(header_length + body_length_);
+}
+
+int ChatMessage::version() const { return version_; }
+void ChatMessage::version(int v) { version_ = v; }
+
+uint32_t ChatMessage::flags() const { return flags_; }
+void ChatMessage::flags(uint32_t f) { flags_ = f & v4_flags_mask; }
+
+std::size_t ChatMessage::max_length_for(int version) {
+    return version >= frame_v4 ? max_frame_length_ : static_cast<std::size_t>(max_body_length);
 }
 
+std::size_t ChatMessage::max_frame_length() { return max_frame_length_; }
+
+void ChatMessage::set_max_frame_length(std::size_t n) {
+    max_frame_length_ = (std::min)(n, static_cast<std::size_t>(v4_length_mask));
+}
+
+// 解析 Header: 首字节最高位为 1 是 v4 二进制长度，否则是 v3 ASCII 长度
 bool ChatMessage::decode_header() {
-    char header[header_length + 1] = "";
-    std::strncat(header, data_, header_length);
-    body_length_ = std::atoi(header);
-    if (body_length_ > max_body_length) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data_.data());
+    std::size_t length = 0;
+    if (p[0] & 0x80) {
+        uint32_t value = (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+            (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+        length = value & v4_length_mask;
+        version_ = frame_v4;
+        flags_ = value & v4_flags_mask;
+    } else {
+        char header[header_length + 1] = "";
+        std::strncat(header, data_.data(), header_length);
+        int value = std::atoi(header);
+        length = value < 0 ? max_body_length + 1 : static_cast<std::size_t>(value);
+        version_ = frame_v3;
+        flags_ = 0;
+    }
+
+    if (length > max_length_for(version_)) {
         body_length_ = 0;
         return false;
     }
+    body_length_ = length;
+    data_.resize(header_length + body_length_);
     return true;
 }
 
-// 编码 Header: 将整数长度格式化为4字节 ASCII 字符串 (例如 " 123")
+// 编码 Header: v3 将整数长度格式化为4字节 ASCII 字符串 (例如 " 123")，v4 写入标志位和大端二进制长度
 void ChatMessage::encode_header() {
+    if (version_ >= frame_v4) {
+        uint32_t value = v4_marker | flags_ | (static_cast<uint32_t>(body_length_) & v4_length_mask);
+        data_[0] = static_cast<char>((value >> 24) & 0xFF);
+        data_[1] = static_cast<char>((value >> 16) & 0xFF);
+        data_[2] = static_cast<char>((value >> 8) & 0xFF);
+        data_[3] = static_cast<char>(value & 0xFF);
+        return;
+    }
+
     char header[header_length + 1] = "";
     std::sprintf(header, "%4d", static_cast<int>(body_length_));
-    std::memcpy(data_, header, header_length);
+    std::memcpy(data_.data(), header, header_length);
 }
 
 // ==========================================
@@ -64,6 +160,10 @@ FuturesClient::FuturesClient(boost::asio::io_context& io_context,
            const tcp::resolver::results_type& endpoints)
     : io_context_(io_context),
       socket_(io_context),
+      heartbeat_timer_(io_context),
+      frame_version_(ChatMessage::frame_v3),
+      use_msgpack_(false),
+      use_deflate_(false),
       request_id_counter_(0) {
 #ifndef SIMULATE_SERVER
     // 正常模式：发起 TCP 连接
@@ -96,6 +196,7 @@ void FuturesClient::login(const std::string& username, const std::string& passwo
     j["request_id"] = generate_request_id();
     j["username"] = username;
     j["password"] = password; 
+    j["compression"] = "deflate";  // 请求服务器压缩大消息，是否启用以登录响应为准
     send_json(j);
 }
 
@@ -173,8 +274,31 @@ void FuturesClient::query_warnings(const std::string& account, const std::string
     send_json(j);
 }
 
+void FuturesClient::batch(std::vector<json> requests) {
+    json j;
+    j["type"] = "batch";
+    j["request_id"] = generate_request_id();
+    for (auto& r : requests) {
+        if (!r.contains("request_id")) {
+            r["request_id"] = generate_request_id();
+        }
+    }
+    j["requests"] = std::move(requests);
+    send_json(j);
+}
+
+void FuturesClient::heartbeat() {
+    json j;
+    j["type"] = "heartbeat";
+    j["request_id"] = generate_request_id();
+    send_json(j);
+}
+
 void FuturesClient::close() {
-    boost::asio::post(io_context_, [this]() { socket_.close(); });
+    boost::asio::post(io_context_, [this]() {
+        heartbeat_timer_.cancel();
+        socket_.close();
+    });
 }
 
 // --- 内部逻辑实现 ---
@@ -185,8 +309,8 @@ std::string FuturesClient::generate_request_id() {
 
 void FuturesClient::send_json(const json& j_in) {
     json j = j_in;
-    // Add common fields
-    j["ver"] = "3.1";
+    // Add common fields (ver >= 4.1 表示支持 MessagePack 消息体，由服务器在登录时决定是否启用)
+    j["ver"] = "4.1";
     j["ts"] = current_timestamp();
 
 #ifdef SIMULATE_SERVER
@@ -196,10 +320,29 @@ void FuturesClient::send_json(const json& j_in) {
     return;
 #endif
 
-    // 正常模式：序列化并发送
+    // 正常模式：序列化并发送（协商了 MessagePack 时以二进制编码发送，需要 v4 帧承载）
     LOG_DEBUG("[FuturesClient] Sending: " << j.dump());
-    std::string s = j.dump();
     ChatMessage msg;
+    msg.version(frame_version_);
+    std::string s;
+    if (use_msgpack_ && msg.version() == ChatMessage::frame_v4) {
+        json::to_msgpack(j, nlohmann::detail::output_adapter<char, std::string>(s));
+        msg.flags(ChatMessage::v4_flag_msgpack);
+    } else {
+        s = j.dump();
+    }
+    // 协商了压缩时大消息 (如批量导入) 压缩后发送，压缩不划算时按原样发送
+    if (use_deflate_ && msg.version() == ChatMessage::frame_v4 && s.size() >= ChatMessage::compress_threshold) {
+        std::string packed;
+        if (compress_body(s, packed)) {
+            s.swap(packed);
+            msg.flags(msg.flags() | ChatMessage::v4_flag_deflate);
+        }
+    }
+    if (s.size() > ChatMessage::max_length_for(msg.version())) {
+        LOG_ERROR("[FuturesClient] Message too large: " << s.size() << " bytes");
+        return;
+    }
     msg.body_length(s.size());
     std::memcpy(msg.body(), s.data(), msg.body_length());
     msg.encode_header();
@@ -222,6 +365,7 @@ void FuturesClient::do_connect(const tcp::resolver::results_type& endpoints) {
         [this](boost::system::error_code ec, tcp::endpoint ep) {
             if (!ec) {
                 LOG_DEBUG("[FuturesClient] Connected to server: " << ep.address().to_string() << ":" << ep.port());
+                schedule_heartbeat();
                 do_read_header();
             } else {
                 LOG_ERROR("[FuturesClient] Connect FAILED: " << ec.message());
@@ -247,14 +391,39 @@ void FuturesClient::do_read_body() {
         boost::asio::buffer(read_msg_.body(), read_msg_.body_length()),
         [this](boost::system::error_code ec, std::size_t /*length*/) {
             if (!ec) {
-                // 收到完整消息，进行 JSON 解析
-                std::string received_data(read_msg_.body(), read_msg_.body_length());
-                LOG_DEBUG("[FuturesClient] Received: " << received_data);
-                try {
-                    json j = json::parse(received_data);
+                // 服务器发来 v4 帧说明已协商成功，之后的请求也改用 v4
+                if (read_msg_.version() == ChatMessage::frame_v4 && frame_version_ != ChatMessage::frame_v4) {
+                    LOG_DEBUG("[FuturesClient] Switched to protocol v4 framing");
+                    frame_version_ = ChatMessage::frame_v4;
+                }
+
+                // 服务器发来 MessagePack 消息体说明登录时已协商成功，之后的请求也改用 MessagePack
+                bool msgpack = (read_msg_.flags() & ChatMessage::v4_flag_msgpack) != 0;
+                if (msgpack && !use_msgpack_) {
+                    LOG_DEBUG("[FuturesClient] Switched to MessagePack body encoding");
+                    use_msgpack_ = true;
+                }
+
+                // 收到完整消息，先按标志位解压，再解析 JSON 文本或 MessagePack
+                const char* first = read_msg_.body();
+                const char* last = first + read_msg_.body_length();
+                std::string inflated;
+                if (read_msg_.flags() & ChatMessage::v4_flag_deflate) {
+                    if (!decompress_body(first, read_msg_.body_length(), inflated)) {
+                        LOG_ERROR("[FuturesClient] Decompress failed, closing socket");
+                        socket_.close();
+                        return;
+                    }
+                    first = inflated.data();
+                    last = first + inflated.size();
+                }
+                json j = msgpack ? json::from_msgpack(first, last, true, false)
+                                 : json::parse(first, last, nullptr, false);
+                if (j.is_discarded()) {
+                    LOG_ERROR("[FuturesClient] " << (msgpack ? "MessagePack" : "JSON") << " parse error");
+                } else {
+                    LOG_DEBUG("[FuturesClient] Received: " << j.dump(-1, ' ', false, json::error_handler_t::replace));
                     handle_message(j);
-                } catch (json::parse_error& e) {
-                    LOG_ERROR("[FuturesClient] JSON parse error: " << e.what());
                 }
 
                 // 继续读取下一条消息的 Header
@@ -266,6 +435,16 @@ void FuturesClient::do_read_body() {
         });
 }
 
+void FuturesClient::schedule_heartbeat() {
+    heartbeat_timer_.expires_after(std::chrono::seconds(heartbeat_interval));
+    heartbeat_timer_.async_wait([this](boost::system::error_code ec) {
+        // 定时器被取消或连接已关闭时停止心跳
+        if (ec || !socket_.is_open()) return;
+        heartbeat();
+        schedule_heartbeat();
+    });
+}
+
 void FuturesClient::handle_message(const json& j) {
     // 1. 协议层逻辑：自动回复 ACK
     // 如果收到预警触发消息，必须回复 ACK 告知服务器已收到
@@ -278,6 +457,18 @@ void FuturesClient::handle_message(const json& j) {
         // 注意：这里不 return，继续向下传递给 UI，因为 UI 也需要弹窗
     }
 
+    // 登录响应确认服务器支持压缩后，之后的大消息也压缩发送
+    if (j.value("type", "") == "response" && j.value("request_type", "") == "login" &&
+        j.value("status", 1) == 0 && j.contains("data") && j["data"].is_object() &&
+        j["data"].value("compression", "") == "deflate") {
+        use_deflate_ = true;
+    }
+
+    // 心跳响应只用于保活，不通知 UI
+    if (j.value("type", "") == "response" && j.value("request_type", "") == "heartbeat") {
+        return;
+    }
+
     // 2. 通知 UI 层
     if (message_callback_) {
         message_callback_(j);
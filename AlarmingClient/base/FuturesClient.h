@@ -1,6 +1,9 @@
 ﻿#pragma once
 
 #include <cstdlib>
+#include <cstdint>
+#include <atomic>
+#include <vector>
 #include <deque>
 #include <iostream>
 #include <string>
@@ -52,12 +55,24 @@ using json = nlohmann::json;
  * 
  * 负责处理 TCP 粘包/拆包问题。
  * 协议格式: [Header (4 bytes)] + [Body (N bytes)]
- * Header 是一个 ASCII 字符串，表示 Body 的长度。
+ * - v3: Header 是一个 ASCII 字符串，表示 Body 的长度 (最大 4KB)。
+ * - v4: Header 是大端 32 位整数，最高位为 v4 标记，第 28 位表示 Body 为 MessagePack，
+ *       第 29 位表示 Body 经 zlib 压缩 (4 字节大端原始长度 + zlib 数据)，
+ *       低 28 位为 Body 长度，上限由 max_frame_length() 配置。两种格式可按首字节逐帧区分。
+ * Body 存放在堆上，按实际长度分配。
  */
 class ChatMessage {
 public:
     enum { header_length = 4 };          ///< 包头长度 (固定 4 字节)
-    enum { max_body_length = 4096 };     ///< 包体最大长度 (4KB)
+    enum { max_body_length = 4096 };     ///< v3 包体最大长度 (4KB)
+    enum { frame_v3 = 3, frame_v4 = 4 }; ///< 帧格式版本
+
+    static const uint32_t v4_marker = 0x80000000u;      ///< v4 标记位
+    static const uint32_t v4_length_mask = 0x0FFFFFFFu; ///< v4 长度位
+    static const uint32_t v4_flags_mask = 0x70000000u;  ///< v4 标志位
+    static const uint32_t v4_flag_msgpack = 0x10000000u; ///< Body 为 MessagePack
+    static const uint32_t v4_flag_deflate = 0x20000000u; ///< Body 经 zlib 压缩
+    enum { compress_threshold = 1024 };  ///< 协商压缩后，Body 达到该长度才压缩
 
     ChatMessage();
 
@@ -70,26 +85,47 @@ public:
     char* body();                        ///< 获取包体数据指针 (可写)
     std::size_t body_length() const;     ///< 获取包体长度
 
-    void body_length(std::size_t new_length); ///< 设置包体长度
+    void body_length(std::size_t new_length); ///< 设置包体长度 (超过当前版本上限时截断)
+
+    int version() const;                 ///< 获取帧格式版本
+    void version(int v);                 ///< 设置帧格式版本 (需在 body_length 之前设置)
+
+    uint32_t flags() const;              ///< 获取 v4 标志位 (v3 帧为 0)
+    void flags(uint32_t f);              ///< 设置 v4 标志位 (encode_header 时写入)
+
+    /**
+     * @brief 指定帧版本允许的最大包体长度
+     */
+    static std::size_t max_length_for(int version);
+
+    /**
+     * @brief v4 包体最大长度 (默认 16MB)
+     */
+    static std::size_t max_frame_length();
+    static void set_max_frame_length(std::size_t n);
 
     // --- 编解码接口 ---
     
     /**
      * @brief 解析包头
-     * 从 data_ 的前 4 个字节解析出 body_length_。
+     * 从 data_ 的前 4 个字节解析出 body_length_、帧版本和标志位，并为包体分配空间。
      * @return true 解析成功, false 解析失败 (长度非法)
      */
     bool decode_header();
 
     /**
      * @brief 编码包头
-     * 将 body_length_ 格式化为 4 字节的 ASCII 字符串并写入 data_ 头部。
+     * v3 将 body_length_ 格式化为 4 字节的 ASCII 字符串，v4 写入标志位和大端二进制长度。
      */
     void encode_header();
 
 private:
-    char data_[header_length + max_body_length]; ///< 数据缓冲区
+    static std::size_t max_frame_length_;        ///< v4 包体最大长度
+
+    std::vector<char> data_;                     ///< 数据缓冲区 (Header + Body)
     std::size_t body_length_;                    ///< 当前包体长度
+    int version_;                                ///< 帧格式版本
+    uint32_t flags_;                             ///< v4 标志位
 };
 
 typedef std::deque<ChatMessage> chat_message_queue;
@@ -185,6 +221,21 @@ public:
      */
     void query_warnings(const std::string& account, const std::string& status_filter);
 
+    /**
+     * @brief 批量发送预警单增删改请求
+     * 服务器在一个事务中执行并返回一条汇总响应 (data.results 与 requests 一一对应)。
+     * @param requests 子请求 (add_warning / delete_warning / modify_warning)，未带 request_id 的自动生成
+     */
+    void batch(std::vector<json> requests);
+
+    /**
+     * @brief 发送心跳
+     * 连接建立后每 heartbeat_interval 秒自动发送一次，服务器长时间收不到任何数据会断开连接。
+     */
+    void heartbeat();
+
+    static constexpr int heartbeat_interval = 30; ///< 心跳间隔 (秒)
+
     /**
      * @brief 关闭连接
      * 线程安全地关闭 Socket 连接。
@@ -212,6 +263,7 @@ private:
     void do_read_body();                                           ///< 读取包体
     void handle_message(const json& j);                            ///< 处理完整的 JSON 消息
     void do_write();                                               ///< 执行实际的 Socket 写入
+    void schedule_heartbeat();                                     ///< 启动下一次心跳定时
 
 #ifdef SIMULATE_SERVER
     /**
@@ -225,8 +277,12 @@ private:
 
     boost::asio::io_context& io_context_;
     tcp::socket socket_;
+    boost::asio::steady_timer heartbeat_timer_;
     ChatMessage read_msg_;
     chat_message_queue write_msgs_;
+    std::atomic<int> frame_version_;  ///< 发送使用的帧格式，收到服务器的 v4 帧后切换为 v4
+    std::atomic<bool> use_msgpack_;   ///< 发送使用 MessagePack 消息体，收到服务器的 MessagePack 消息后切换
+    std::atomic<bool> use_deflate_;   ///< 大消息压缩发送，登录响应确认服务器支持后启用
     int request_id_counter_;
     MessageCallback message_callback_;
 };
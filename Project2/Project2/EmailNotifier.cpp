@@ -81,11 +81,10 @@ std::string EmailNotifier::GetFormattedTime() {
 }
 
 std::string EmailNotifier::GetUserEmail(const std::string& account) {
+    ConnectionLease conn;
     try {
-        std::unique_ptr<sql::Connection> conn(GetConn());
-        std::unique_ptr<sql::PreparedStatement> stmt(
-            conn->prepareStatement("SELECT email FROM user WHERE account = ?")
-        );
+        conn = GetConn();
+        sql::PreparedStatement* stmt = conn.Prepare("SELECT email FROM user WHERE account = ?");
         stmt->setString(1, account);
         std::unique_ptr<sql::ResultSet> res(stmt->executeQuery());
         if (res->next()) {
@@ -93,6 +92,7 @@ std::string EmailNotifier::GetUserEmail(const std::string& account) {
         }
     }
     catch (sql::SQLException& e) {
+        conn.InvalidateOnConnectionError();
         printf("[DB ERROR] GetUserEmail: %s\n", e.what());
     }
     return std::string();
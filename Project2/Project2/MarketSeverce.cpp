@@ -37,12 +37,10 @@ std::vector<std::string> LoadContractsFromDB()
 {
     std::vector<std::string> contracts;
 
+    ConnectionLease conn;
     try {
-        sql::Connection* conn = GetConn();
-        std::unique_ptr<sql::Connection> connPtr(conn);
-        std::unique_ptr<sql::PreparedStatement> stmt(
-            conn->prepareStatement("SELECT DISTINCT symbol FROM alert_order WHERE state=0")
-        );
+        conn = GetConn();
+        sql::PreparedStatement* stmt = conn.Prepare("SELECT DISTINCT symbol FROM alert_order WHERE state=0");
         std::unique_ptr<sql::ResultSet> res(stmt->executeQuery());
 
         while (res->next()) {
@@ -56,6 +54,7 @@ std::vector<std::string> LoadContractsFromDB()
         fflush(stdout);
     }
     catch (sql::SQLException& e) {
+        conn.InvalidateOnConnectionError();
         printf("[DB ERROR] غԼбʧ: %s\n", e.what());
         fflush(stdout);
     }
@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include "tradeapi/ThostFtdcMdApi.h"
 #include "EmailNotifier.h"
+#include "executor.h"
 #include <Windows.h>
 #include <stdio.h>
 #include <vector>
@@ -10,6 +11,7 @@
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include <atomic>
 #include <thread>
 #include <functional>
@@ -17,8 +19,15 @@
 
 
 #include <mysql/jdbc.h>
+#include "db_manager.h"
+#include "alert_state_writer.h"
 using namespace std;
 
+// 预警单重载配置
+const int ALERT_RELOAD_INTERVAL_SEC = 3;            // 增量重载的间隔
+const int ALERT_RELOAD_OVERLAP_SEC = 5;             // 增量查询从高水位向前多取的时间，覆盖修改后过一会儿才提交的事务
+const int ALERT_FULL_RELOAD_INTERVAL_SEC = 600;     // 全量重载的间隔（兜底：库外删除的行、提交更晚的事务）
+
 
 
 // ------------------------- Notifier -------------------------
@@ -56,12 +65,10 @@ public:
 };
 
 // ------------------------- DB 连接 -------------------------
-static sql::Connection* GetConn()
+// 与请求处理共用 DBManager 连接池（同一个库），租约析构时归还连接
+static ConnectionLease GetConn()
 {
-    sql::Driver* driver = get_driver_instance();
-    sql::Connection* conn = driver->connect("tcp://127.0.0.1:3306", "root", "1234");
-    conn->setSchema("futurescloudsentinel");
-    return conn;
+    return DBManager::GetInstance()->Acquire();
 }
 
 // ------------------------- 预警结构体 -------------------------
@@ -93,10 +100,19 @@ private:
     unordered_map<string, double> m_lastPrices;
     mutex m_priceMutex;
 
-    // 从数据库加载的预警缓存
+    // 从数据库加载的预警缓存（按合约分组），以及 orderId 到合约的索引，用于按增量更新
     unordered_map<string, vector<AlertOrder>> m_alertMap;
+    unordered_map<long, string> m_alertSymbol;
     mutex m_alertMutex;
 
+    // 增量重载状态（只由重载线程访问）
+    string m_reloadMark;                                // 高水位：上次查询前的数据库时间，为空时下次全量加载
+    bool m_hasUpdatedAt{ false };                       // alert_order 是否有 updated_at 列
+    chrono::steady_clock::time_point m_lastFullReload;
+
+    // 暂停预警判断（热升级交接期间由新进程接手，两边不重复触发）
+    atomic<bool> m_alertsPaused{ false };
+
     // 线程控制
     atomic<bool> m_runAlertReload{ false };
     thread m_reloadThread;
@@ -108,6 +124,19 @@ private:
 
 public:
 
+    // 进程内唯一的行情处理器：行情服务与请求处理（删除预警单时更新缓存）共用
+    static CMduserHandler& GetHandler()
+    {
+        static CMduserHandler handler;
+        return handler;
+    }
+
+    // 暂停/恢复预警判断：暂停期间行情照常接收，但不触发预警
+    void SetAlertsPaused(bool paused)
+    {
+        m_alertsPaused = paused;
+    }
+
     CMduserHandler()
     {
         m_notifier = make_shared<ConsoleNotifier>();
@@ -133,11 +162,12 @@ public:
     void StartAlertReloadThread()
     {
         m_runAlertReload = true;
+        m_reloadMark.clear();
         m_reloadThread = thread([this]() {
             while (m_runAlertReload.load())
             {
                 ReloadAlertsFromDB();
-                this_thread::sleep_for(chrono::seconds(3));
+                this_thread::sleep_for(chrono::seconds(ALERT_RELOAD_INTERVAL_SEC));
             }
             });
     }
@@ -150,58 +180,166 @@ public:
     }
 
     // ===================== 从数据库读取预警单 =====================
+    // 首次及每隔 ALERT_FULL_RELOAD_INTERVAL_SEC 全量加载 state=0 的预警单，其余时候只取
+    // updated_at 在上次高水位之后变化的行，按增量更新内存缓存（state=0 的新增或替换，其余移除），
+    // 活跃预警单很多时每轮只读少量行。依赖数据库自动维护的修改时间列及其索引：
+    //   ALTER TABLE alert_order
+    //     ADD COLUMN updated_at TIMESTAMP(6) NOT NULL DEFAULT CURRENT_TIMESTAMP(6) ON UPDATE CURRENT_TIMESTAMP(6),
+    //     ADD INDEX idx_alert_order_updated_at (updated_at);
+    // 没有该列时每轮全量加载
     void ReloadAlertsFromDB()
     {
+        ConnectionLease conn;
         try {
-            unique_ptr<sql::Connection> conn(GetConn());
-            unique_ptr<sql::PreparedStatement> stmt(
-                conn->prepareStatement(
-                    "SELECT orderId, account, symbol, max_price, min_price, trigger_time, state "
-                    "FROM alert_order WHERE state=0"
-                )
-            );
-            unique_ptr<sql::ResultSet> res(stmt->executeQuery());
-
-            unordered_map<string, vector<AlertOrder>> tmp;
-
-            while (res->next())
-            {
-                AlertOrder a;
-                a.orderId = res->getInt("orderId");
-                a.account = res->getString("account");
-                a.symbol = res->getString("symbol");
-                a.max_price = res->getDouble("max_price");
-                a.min_price = res->getDouble("min_price");
-                a.trigger_time = res->getString("trigger_time");  // 加载时间字段
-                a.state = res->getInt("state");
-
-                tmp[a.symbol].push_back(a);
+            conn = GetConn();
+            auto now = chrono::steady_clock::now();
+            bool full = m_reloadMark.empty() ||
+                now - m_lastFullReload >= chrono::seconds(ALERT_FULL_RELOAD_INTERVAL_SEC);
+            if (full) {
+                // 每次全量加载时重新检查，表结构升级后不必重启
+                m_hasUpdatedAt = HasUpdatedAtColumn(conn);
             }
 
-            lock_guard<mutex> lk(m_alertMutex);
-            m_alertMap.swap(tmp);
+            // 先取数据库当前时间作为下一轮的高水位，查询期间提交的修改留给下一轮
+            string mark;
+            if (m_hasUpdatedAt) {
+                sql::PreparedStatement* stmt = conn.Prepare("SELECT NOW(6) AS now");
+                unique_ptr<sql::ResultSet> res(stmt->executeQuery());
+                if (res->next()) mark = res->getString("now");
+            }
+
+            if (full) {
+                LoadAllAlerts(conn);
+                m_lastFullReload = now;
+            }
+            else {
+                LoadChangedAlerts(conn);
+            }
+            m_reloadMark = mark;
         }
         catch (sql::SQLException& e) {
+            conn.InvalidateOnConnectionError();
             printf("[DB ERROR] ReloadAlerts: %s\n", e.what());
             fflush(stdout);
         }
     }
 
-    // ===================== 更新数据库状态（触发预警） =====================
-    void MarkAlertTriggered(long orderId)
+    static bool HasUpdatedAtColumn(ConnectionLease& conn)
     {
-        try {
-            unique_ptr<sql::Connection> conn(GetConn());
-            unique_ptr<sql::PreparedStatement> stmt(
-                conn->prepareStatement("UPDATE alert_order SET state=1 WHERE orderId=?")
-            );
-            stmt->setInt(1, orderId);
-            stmt->execute();
+        sql::PreparedStatement* stmt = conn.Prepare(
+            "SELECT COUNT(*) AS n FROM information_schema.COLUMNS "
+            "WHERE TABLE_SCHEMA=DATABASE() AND TABLE_NAME='alert_order' AND COLUMN_NAME='updated_at'");
+        unique_ptr<sql::ResultSet> res(stmt->executeQuery());
+        return res->next() && res->getInt("n") > 0;
+    }
+
+    static AlertOrder ReadAlertOrder(sql::ResultSet& res)
+    {
+        AlertOrder a;
+        a.orderId = res.getInt("orderId");
+        a.account = res.getString("account");
+        a.symbol = res.getString("symbol");
+        a.max_price = res.getDouble("max_price");
+        a.min_price = res.getDouble("min_price");
+        a.trigger_time = res.getString("trigger_time");  // 加载时间字段
+        a.state = res.getInt("state");
+        return a;
+    }
+
+    // 已触发但状态尚未回写的单子在数据库中仍是 state=0，不能重新载入。
+    // 回写队列在查询前后各取一次快照，两者都要排除：
+    // 查询读到 state=0 之后才写完并离开队列的单子只在查询前的快照中；
+    // 查询之后才触发的单子只在之后的快照中（触发时先入队，再持 m_alertMutex 从缓存移除，
+    // 因此之后的快照在持有 m_alertMutex 时获取）。LoadAllAlerts 与 LoadChangedAlerts 都按此处理
+
+    // 全量加载：重建缓存
+    void LoadAllAlerts(ConnectionLease& conn)
+    {
+        unordered_set<long long> pendingBefore = AlertStateWriter::Instance().PendingSnapshot();
+        sql::PreparedStatement* stmt = conn.Prepare(
+            "SELECT orderId, account, symbol, max_price, min_price, trigger_time, state "
+            "FROM alert_order WHERE state=0");
+        unique_ptr<sql::ResultSet> res(stmt->executeQuery());
+
+        unordered_map<string, vector<AlertOrder>> tmp;
+        unordered_map<long, string> symbols;
+        while (res->next())
+        {
+            AlertOrder a = ReadAlertOrder(*res);
+            if (pendingBefore.count(a.orderId)) continue;
+            symbols[a.orderId] = a.symbol;
+            tmp[a.symbol].push_back(std::move(a));
         }
-        catch (...) {
-            printf("[DB ERROR] 更新预警状态失败\n");
-            fflush(stdout);
+
+        lock_guard<mutex> lk(m_alertMutex);
+        m_alertMap.swap(tmp);
+        m_alertSymbol.swap(symbols);
+        // 查询之后进入回写队列的单子（通常很少）从新缓存中移除
+        for (long long orderId : AlertStateWriter::Instance().PendingSnapshot())
+        {
+            if (!pendingBefore.count(orderId)) RemoveAlertLocked(static_cast<long>(orderId));
+        }
+    }
+
+    // 增量加载：只读取高水位之后修改过的行（含已触发/已确认的），逐条替换或移除
+    void LoadChangedAlerts(ConnectionLease& conn)
+    {
+        sql::PreparedStatement* stmt = conn.Prepare(
+            "SELECT orderId, account, symbol, max_price, min_price, trigger_time, state "
+            "FROM alert_order WHERE updated_at >= DATE_SUB(?, INTERVAL ? SECOND)");
+        stmt->setString(1, m_reloadMark);
+        stmt->setInt(2, ALERT_RELOAD_OVERLAP_SEC);
+        unordered_set<long long> pendingBefore = AlertStateWriter::Instance().PendingSnapshot();
+        unique_ptr<sql::ResultSet> res(stmt->executeQuery());
+
+        vector<AlertOrder> changed;
+        while (res->next())
+        {
+            changed.push_back(ReadAlertOrder(*res));
+        }
+        if (changed.empty()) return;
+
+        lock_guard<mutex> lk(m_alertMutex);
+        unordered_set<long long> pendingAfter = AlertStateWriter::Instance().PendingSnapshot();
+        for (auto& a : changed)
+        {
+            RemoveAlertLocked(a.orderId);
+            if (a.state != 0 || pendingBefore.count(a.orderId) || pendingAfter.count(a.orderId)) continue;
+            m_alertSymbol[a.orderId] = a.symbol;
+            m_alertMap[a.symbol].push_back(std::move(a));
+        }
+    }
+
+    // 从缓存中移除一条预警单，调用者持有 m_alertMutex
+    void RemoveAlertLocked(long orderId)
+    {
+        auto sit = m_alertSymbol.find(orderId);
+        if (sit == m_alertSymbol.end()) return;
+
+        auto it = m_alertMap.find(sit->second);
+        if (it != m_alertMap.end())
+        {
+            auto& vec = it->second;
+            vec.erase(std::remove_if(vec.begin(), vec.end(),
+                [orderId](const AlertOrder& x) { return x.orderId == orderId; }), vec.end());
+            if (vec.empty())
+                m_alertMap.erase(it);
         }
+        m_alertSymbol.erase(sit);
+    }
+
+    // 删除预警单后立即从缓存中移除（物理删除的行不会出现在增量查询中）
+    void RemoveAlert(long long orderId)
+    {
+        lock_guard<mutex> lk(m_alertMutex);
+        RemoveAlertLocked(static_cast<long>(orderId));
+    }
+
+    // ===================== 更新数据库状态（触发预警） =====================
+    // 只放入回写队列，由执行器上的回写任务批量执行，可在行情回调线程上直接调用
+    void MarkAlertTriggered(long orderId)
+    {
+        AlertStateWriter::Instance().MarkTriggered(orderId);
     }
 
     // =====================================================
@@ -392,6 +530,8 @@ public:
     // 根据 symbol 和 price 判断预警
     void CheckAlert(const string& symbol, double price)
     {
+        if (m_alertsPaused) return;
+
         vector<AlertOrder> alerts;
 
         {
@@ -454,9 +594,13 @@ public:
 
             if (triggered)
             {
-                // 先通知并在 DB 标记
-                m_notifier->Notify(a.account, symbol, price, reason);
+                // 状态回写只入队；邮件发送较慢，交给后台执行器，不阻塞行情回调线程
                 MarkAlertTriggered(a.orderId);
+                shared_ptr<INotifier> notifier = m_notifier;
+                string account = a.account;
+                PostBackgroundTask([notifier, account, symbol, price, reason]() {
+                    notifier->Notify(account, symbol, price, reason);
+                });
 
                 // 立即记录，需要在内存中移除，避免短时间重复触发
                 triggeredIds.push_back(a.orderId);
@@ -479,6 +623,8 @@ public:
                 if (vec.empty())
                     m_alertMap.erase(it);
             }
+            for (long id : triggeredIds)
+                m_alertSymbol.erase(id);
         }
     }
 
@@ -0,0 +1,151 @@
+﻿#include "alert_state_writer.h"
+#include "db_manager.h"
+#include "executor.h"
+#include <jdbc/cppconn/statement.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+AlertStateWriter& AlertStateWriter::Instance() {
+    static AlertStateWriter instance;
+    return instance;
+}
+
+void AlertStateWriter::Start() {
+    bool post;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running) return;
+        running = true;
+        // 启动前入队的更新
+        post = !queue.empty() && !scheduled;
+        scheduled = scheduled || post;
+    }
+    if (post) {
+        PostBackgroundTask([this]() { Flush(); });
+    }
+}
+
+void AlertStateWriter::Stop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!running) return;
+    running = false;
+    idleCv.wait(lock, [this] { return !scheduled; });
+
+    if (!DrainLocked(lock)) {
+        std::cerr << "[预警状态回写] 退出时仍有 " << queue.size() << " 条状态未写入数据库" << std::endl;
+    }
+}
+
+bool AlertStateWriter::FlushNow() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idleCv.wait(lock, [this] { return !scheduled; });
+    // 占住 scheduled，写入期间入队的更新不另行投递
+    scheduled = true;
+    bool drained = DrainLocked(lock);
+    if (drained) {
+        retryWaiting = false;
+    }
+    scheduled = false;
+    idleCv.notify_all();
+    return drained;
+}
+
+bool AlertStateWriter::DrainLocked(std::unique_lock<std::mutex>& lock) {
+    while (!queue.empty()) {
+        std::size_t count = (std::min)(queue.size(), ALERT_WRITE_MAX_BATCH);
+        std::vector<long long> batch(queue.begin(), queue.begin() + count);
+        lock.unlock();
+        bool written = WriteBatch(batch);
+        lock.lock();
+        if (!written) return false;
+        queue.erase(queue.begin(), queue.begin() + count);
+        for (long long id : batch) {
+            pending.erase(id);
+        }
+    }
+    return true;
+}
+
+void AlertStateWriter::RetryIfDue() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running || !retryWaiting || scheduled || std::chrono::steady_clock::now() < retryAt) return;
+        retryWaiting = false;
+        scheduled = true;
+    }
+    PostBackgroundTask([this]() { Flush(); });
+}
+
+void AlertStateWriter::MarkTriggered(long long orderId) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!pending.insert(orderId).second) return;
+        queue.push_back(orderId);
+        // 已有回写任务时由它写入；等待重试期间只入队
+        if (!running || scheduled || retryWaiting) return;
+        scheduled = true;
+    }
+    PostBackgroundTask([this]() { Flush(); });
+}
+
+std::unordered_set<long long> AlertStateWriter::PendingSnapshot() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending;
+}
+
+// 回写任务：写入一批，队列中还有更新时重新投递（不在本线程循环，让其他任务有机会执行）
+void AlertStateWriter::Flush() {
+    std::vector<long long> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::size_t count = (std::min)(queue.size(), ALERT_WRITE_MAX_BATCH);
+        batch.assign(queue.begin(), queue.begin() + count);
+        queue.erase(queue.begin(), queue.begin() + count);
+    }
+
+    bool written = batch.empty() || WriteBatch(batch);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (written) {
+            for (long long id : batch) {
+                pending.erase(id);
+            }
+        }
+        else {
+            // 写入失败：放回队首，由 RetryIfDue 到期后重新投递；停止时由 Stop 处理剩余更新
+            queue.insert(queue.begin(), batch.begin(), batch.end());
+            retryWaiting = true;
+            retryAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(ALERT_WRITE_RETRY_MS);
+        }
+        if (!written || queue.empty() || !running) {
+            scheduled = false;
+            idleCv.notify_all();
+            return;
+        }
+    }
+    PostBackgroundTask([this]() { Flush(); });
+}
+
+bool AlertStateWriter::WriteBatch(const std::vector<long long>& ids) {
+    // orderId 都是整数，直接拼入 SQL；每批个数不固定，不进连接的预编译语句缓存
+    std::string sql = "UPDATE alert_order SET state=1 WHERE orderId IN (";
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        if (i > 0) sql += ',';
+        sql += std::to_string(ids[i]);
+    }
+    sql += ')';
+
+    ConnectionLease conn;
+    try {
+        conn = DBManager::GetInstance()->Acquire();
+        std::unique_ptr<Statement> stmt(conn->createStatement());
+        stmt->executeUpdate(sql);
+        return true;
+    }
+    catch (SQLException& e) {
+        conn.InvalidateOnConnectionError();
+        std::cerr << "[预警状态回写] 批量更新 " << ids.size() << " 条失败: " << e.what() << std::endl;
+        return false;
+    }
+}
@@ -0,0 +1,65 @@
+﻿#pragma once
+#ifndef ALERT_STATE_WRITER_H
+#define ALERT_STATE_WRITER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+// 预警单状态回写配置
+const std::size_t ALERT_WRITE_MAX_BATCH = 500;      // 一条 UPDATE ... IN (...) 最多携带的 orderId 数
+const int ALERT_WRITE_RETRY_MS = 1000;              // 写入失败后重试的间隔
+
+// 预警单状态回写队列（单例）：预警触发和 alert_ack 只把 orderId 放入内存队列后立即返回，
+// 由执行器上的回写任务（PostBackgroundTask）合并为 UPDATE alert_order SET state=1 WHERE orderId IN (...) 批量执行，
+// 行情回调线程和请求处理线程都不再等待 MySQL。
+// 同时只有一个回写任务，任务排队和执行期间入队的更新合并到下一批。
+// 写入前重复入队的 orderId 只写一次；写入失败的 orderId 放回队首，由 RetryIfDue 到期后重试，
+// 数据库不可用期间不会丢失，Stop 时写完剩余的更新再返回。
+// 入队到写入之间数据库中仍是 state=0，从数据库加载预警单的地方需跳过 PendingSnapshot 中的单子
+class AlertStateWriter {
+public:
+    static AlertStateWriter& Instance();
+
+    // 开始投递回写任务（执行器启动之后调用）
+    void Start();
+    // 等待正在执行的回写任务结束，在调用线程上写完剩余的更新后返回（此时数据库仍不可用则放弃剩余更新）
+    void Stop();
+
+    // 写入失败后等待重试的更新到期时重新投递回写任务；由主线程周期调用
+    void RetryIfDue();
+
+    // 等待正在执行的回写任务结束，在调用线程上写完队列中的更新后返回，之后照常运行。
+    // 返回 false 表示数据库不可用，仍有更新未写入（热升级交接前调用）
+    bool FlushNow();
+
+    // 标记预警单已触发/已确认（state=1），只入队，不访问数据库
+    void MarkTriggered(long long orderId);
+
+    // 已入队但尚未写入数据库的 orderId（含正在写入的一批）
+    std::unordered_set<long long> PendingSnapshot() const;
+
+private:
+    AlertStateWriter() : running(false), scheduled(false), retryWaiting(false) {}
+    AlertStateWriter(const AlertStateWriter&) = delete;
+    AlertStateWriter& operator=(const AlertStateWriter&) = delete;
+
+    void Flush();
+    // 在调用线程上写完 queue，调用者持有 lock 且已确保没有回写任务在执行；写入失败时返回 false
+    bool DrainLocked(std::unique_lock<std::mutex>& lock);
+    bool WriteBatch(const std::vector<long long>& ids);
+
+    mutable std::mutex mutex;
+    std::condition_variable idleCv;             // 回写任务结束（scheduled 变为 false）
+    std::vector<long long> queue;               // 等待写入的 orderId，按入队顺序
+    std::unordered_set<long long> pending;      // queue 与正在写入的 orderId，用于去重
+    bool running;
+    bool scheduled;                             // 回写任务已投递或正在执行
+    bool retryWaiting;                          // 上次写入失败，retryAt 之前不再投递
+    std::chrono::steady_clock::time_point retryAt;
+};
+
+#endif // ALERT_STATE_WRITER_H
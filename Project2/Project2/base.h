@@ -3,6 +3,10 @@
 #define BASE_H
 
 #include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
 #include <deque>
 #include <string>
 #include <boost/asio.hpp>
@@ -12,56 +16,138 @@ using boost::asio::ip::tcp;
 using json = nlohmann::json;
 
 // ϢЭ鶨
+// v34 ֽ ASCII ʮƳͷ"%4d"Ϣ max_body_length
+// v44 ֽڴ˶ƳͷλΪ v4 ǣASCII ͷֽڱС 0x80֣֡
+//     28~30 λΪ/ѹ־28 λϢΪ MessagePack29 λϢ徭 zlib ѹ
+//      28 λΪϢ峤ȣ max_frame_length() 
+// ϢĬ JSON ı¼ʱЭ̺ɸ MessagePackֻ v4 ֡
 class ChatMessage {
 public:
     enum { header_length = 4 };         // Ϣͷȣڴ洢Ϣ峤ȣ
-    enum { max_body_length = 4096 };    // Ϣ峤ȣӦJSONݣ
+    enum { max_body_length = 4096 };    // v3 Ϣ峤ȣӦJSONݣ
+    enum { frame_v3 = 3, frame_v4 = 4 };
 
-    ChatMessage() : body_length_(0) {}
+    static const uint32_t v4_marker = 0x80000000u;
+    static const uint32_t v4_flags_mask = 0x70000000u;
+    static const uint32_t v4_length_mask = 0x0FFFFFFFu;
+    static const uint32_t v4_flag_msgpack = 0x10000000u;
+    static const uint32_t v4_flag_deflate = 0x20000000u;    // ϢΪ 4 ֽڴԭʼ + zlib 
+
+    // Ϣ
+    enum { body_json = 0, body_msgpack = 1 };
+
+    ChatMessage() : data_(header_length), body_length_(0), version_(frame_v3) {}
 
     // ȡϢݵĳָָͨ
-    const char* data() const { return data_; }
-    char* data() { return data_; }
+    const char* data() const { return data_.data(); }
+    char* data() { return data_.data(); }
 
     // ȡϢܳȣͷ+岿
     std::size_t length() const { return header_length + body_length_; }
 
     // ȡϢĳָָͨ
-    const char* body() const { return data_ + header_length; }
-    char* body() { return data_ + header_length; }
+    const char* body() const { return data_.data() + header_length; }
+    char* body() { return data_.data() + header_length; }
 
-    // ȡϢ峤
+    // ȡϢ峤ȣϢڶϣչ
     std::size_t body_length() const { return body_length_; }
-#include "base.h"
 
     void body_length(std::size_t new_length) {
         body_length_ = new_length;
-        if (body_length_ > max_body_length)
-            body_length_ = max_body_length;
+        if (body_length_ > max_length_for(version_))
+            body_length_ = max_length_for(version_);
+        data_.resize(header_length + body_length_);
     }
 
+    // ֡ʽ汾frame_v3 / frame_v4
+    int version() const { return version_; }
+    void version(int v) { version_ = v; }
+
     bool decode_header() {
+        if (!parse_header(data(), body_length_, &version_)) {
+            body_length_ = 0;
+            return false;
+        }
+        data_.resize(header_length + body_length_);
+        return true;
+    }
+
+    //  header_length ֽڵϢͷϢ峤ȣҪϢͷλ data_ У
+    // Զʶ v3/v4 ʽversion ǿʱ֡汾flags ǿʱ v4 ־λv3 Ϊ 0
+    static bool parse_header(const char* data, std::size_t& length, int* version = nullptr, uint32_t* flags = nullptr) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+        if (p[0] & 0x80) {
+            uint32_t value = (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+                (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+            std::size_t v4Length = value & v4_length_mask;
+            if (v4Length > max_frame_length()) {
+                return false;
+            }
+            length = v4Length;
+            if (version) *version = frame_v4;
+            if (flags) *flags = value & v4_flags_mask;
+            return true;
+        }
+
         char header[header_length + 1] = "";
         //strncat_s(header, data_, header_length);
-		strncat_s(header, sizeof(header), data_, header_length);
-        body_length_ = std::atoi(header);
-        if (body_length_ > max_body_length) {
-            body_length_ = 0;
+		strncat_s(header, sizeof(header), data, header_length);
+        int value = std::atoi(header);
+        if (value < 0 || value > max_body_length) {
             return false;
         }
+        length = static_cast<std::size_t>(value);
+        if (version) *version = frame_v3;
+        if (flags) *flags = 0;
         return true;
     }
 
     void encode_header() {
+        format_header(data(), body_length_, version_);
+    }
+
+    // Ϣ峤ȱΪ header_length ֽڵϢͷд outflags ֻ v4 ֡д
+    static void format_header(char* out, std::size_t length, int version = frame_v3, uint32_t flags = 0) {
+        if (version >= frame_v4) {
+            uint32_t value = v4_marker | (flags & v4_flags_mask) | (static_cast<uint32_t>(length) & v4_length_mask);
+            out[0] = static_cast<char>((value >> 24) & 0xFF);
+            out[1] = static_cast<char>((value >> 16) & 0xFF);
+            out[2] = static_cast<char>((value >> 8) & 0xFF);
+            out[3] = static_cast<char>(value & 0xFF);
+            return;
+        }
+
         char header[header_length + 1] = "";
         //std::sprintf(header, "%4d", static_cast<int>(body_length_));
-		sprintf_s(header, sizeof(header), "%4d", static_cast<int>(body_length_));
-        std::memcpy(data_, header, header_length);
+		sprintf_s(header, sizeof(header), "%4d", static_cast<int>(length));
+        std::memcpy(out, header, header_length);
+    }
+
+    // ϢǷΪ MessagePack嶥ΪJSON ı '{' հ׿ͷ
+    // MessagePack  map  0x80~0x8f / 0xde / 0xdf ͷֽ߰ڼ
+    static bool is_msgpack_body(const char* body, std::size_t length) {
+        if (length == 0) return false;
+        unsigned char c = static_cast<unsigned char>(body[0]);
+        return (c >= 0x80 && c <= 0x8f) || c == 0xde || c == 0xdf;
+    }
+
+    // ָ֡汾Ϣ峤
+    static std::size_t max_length_for(int version) {
+        return version >= frame_v4 ? max_frame_length() : static_cast<std::size_t>(max_body_length);
+    }
+
+    // v4 Ϣ峤ȣʱͨ --max-frame-bytes ã
+    static std::size_t max_frame_length() { return max_frame_length_; }
+    static void set_max_frame_length(std::size_t n) {
+        max_frame_length_ = (std::min)(n, static_cast<std::size_t>(v4_length_mask));
     }
 
 private:
-    char data_[header_length + max_body_length];  // 洢Ϣͷ+岿
-    std::size_t body_length_;                     // Ϣʵʳ
+    static inline std::size_t max_frame_length_ = 16 * 1024 * 1024;
+
+    std::vector<char> data_;      // 洢Ϣͷ+岿
+    std::size_t body_length_;     // Ϣʵʳ
+    int version_;                 // ֡ʽ汾
 };
 
 #endif // BASE_H
\ No newline at end of file
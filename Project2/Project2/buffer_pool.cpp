@@ -0,0 +1,61 @@
+﻿#include "buffer_pool.h"
+
+BufferPool& BufferPool::Instance() {
+    static BufferPool pool;
+    return pool;
+}
+
+BufferPool::BufferPool() {
+    std::size_t count = 0;
+    for (std::size_t size = BUFFER_POOL_MIN_BLOCK; size <= BUFFER_POOL_MAX_BLOCK; size *= 2) {
+        ++count;
+    }
+    classes = std::vector<SizeClass>(count);
+}
+
+std::size_t BufferPool::ClassIndex(std::size_t capacity) {
+    std::size_t index = 0;
+    for (std::size_t size = BUFFER_POOL_MIN_BLOCK; size < capacity; size *= 2) {
+        ++index;
+    }
+    return index;
+}
+
+char* BufferPool::Acquire(std::size_t size, std::size_t& capacity) {
+    if (size > BUFFER_POOL_MAX_BLOCK) {
+        capacity = size;
+        return new char[size];
+    }
+
+    capacity = BUFFER_POOL_MIN_BLOCK;
+    while (capacity < size) capacity *= 2;
+
+    SizeClass& sc = classes[ClassIndex(capacity)];
+    {
+        std::lock_guard<std::mutex> lk(sc.mutex);
+        if (!sc.freeBlocks.empty()) {
+            char* block = sc.freeBlocks.back();
+            sc.freeBlocks.pop_back();
+            return block;
+        }
+    }
+    return new char[capacity];
+}
+
+void BufferPool::Release(char* buffer, std::size_t capacity) {
+    if (buffer == nullptr) return;
+    if (capacity > BUFFER_POOL_MAX_BLOCK) {
+        delete[] buffer;
+        return;
+    }
+
+    SizeClass& sc = classes[ClassIndex(capacity)];
+    {
+        std::lock_guard<std::mutex> lk(sc.mutex);
+        if (sc.freeBlocks.size() * capacity < BUFFER_POOL_MAX_CACHED_BYTES) {
+            sc.freeBlocks.push_back(buffer);
+            return;
+        }
+    }
+    delete[] buffer;
+}
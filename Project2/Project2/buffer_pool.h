@@ -0,0 +1,41 @@
+﻿#pragma once
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// 共享缓冲区池配置
+const std::size_t BUFFER_POOL_MIN_BLOCK = 4096;                     // 最小块，按 2 的幂分级
+const std::size_t BUFFER_POOL_MAX_BLOCK = 1024 * 1024;              // 超过此大小直接向系统申请、用完即释放
+const std::size_t BUFFER_POOL_MAX_CACHED_BYTES = 4 * 1024 * 1024;   // 每一级最多缓存的空闲字节数
+
+// 所有连接共享的接收缓冲区池：连接平时只用上下文中的小内联缓冲区，
+// 收到大帧时才从这里借一块，缓冲区读空后立即归还，供其他连接复用。
+class BufferPool {
+public:
+    static BufferPool& Instance();
+
+    // 借出至少 size 字节的缓冲区，capacity 输出实际大小。
+    // 调用方按已收到的数据逐级申请（见 FrameDecoder），不按对端声明的长度直接申请大块
+    char* Acquire(std::size_t size, std::size_t& capacity);
+    // 归还缓冲区，capacity 必须是 Acquire 输出的大小
+    void Release(char* buffer, std::size_t capacity);
+
+private:
+    BufferPool();
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    struct SizeClass {
+        std::mutex mutex;
+        std::vector<char*> freeBlocks;
+    };
+
+    static std::size_t ClassIndex(std::size_t capacity);
+
+    std::vector<SizeClass> classes;
+};
+
+#endif // BUFFER_POOL_H
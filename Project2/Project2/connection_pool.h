@@ -0,0 +1,105 @@
+﻿#pragma once
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+// 每块 slab 容纳的对象数
+const std::size_t SLAB_OBJECTS = 256;
+
+// 定长对象的 slab 池：一次向系统申请一整块，释放的对象进入空闲链表，
+// 连接断开再接入时直接复用，避免成千上万个连接上下文各自零散分配。
+// slab 在进程生命周期内不归还系统。
+template <std::size_t Size, std::size_t Align>
+class SlabPool {
+public:
+    static SlabPool& Instance() {
+        static SlabPool pool;
+        return pool;
+    }
+
+    void* Allocate() {
+        std::lock_guard<std::mutex> lk(mutex);
+        if (freeList == nullptr) {
+            Refill();
+        }
+        FreeNode* node = freeList;
+        freeList = node->next;
+        return node;
+    }
+
+    void Free(void* p) {
+        std::lock_guard<std::mutex> lk(mutex);
+        FreeNode* node = static_cast<FreeNode*>(p);
+        node->next = freeList;
+        freeList = node;
+    }
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    static const std::size_t Alignment = Align > alignof(FreeNode) ? Align : alignof(FreeNode);
+    static const std::size_t SlotSize =
+        ((Size > sizeof(FreeNode) ? Size : sizeof(FreeNode)) + Alignment - 1) / Alignment * Alignment;
+
+    SlabPool() : freeList(nullptr) {}
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    void Refill() {
+        char* slab = static_cast<char*>(::operator new(SlotSize * SLAB_OBJECTS, std::align_val_t(Alignment)));
+        slabs.push_back(slab);
+        for (std::size_t i = SLAB_OBJECTS; i > 0; --i) {
+            FreeNode* node = reinterpret_cast<FreeNode*>(slab + (i - 1) * SlotSize);
+            node->next = freeList;
+            freeList = node;
+        }
+    }
+
+    std::mutex mutex;
+    FreeNode* freeList;
+    std::vector<char*> slabs;
+};
+
+// 供 std::allocate_shared 使用的分配器：对象与 shared_ptr 控制块一起从 slab 池分配
+template <class T>
+struct SlabAllocator {
+    typedef T value_type;
+
+    SlabAllocator() = default;
+    template <class U>
+    SlabAllocator(const SlabAllocator<U>&) {}
+
+    T* allocate(std::size_t n) {
+        if (n != 1) return static_cast<T*>(::operator new(n * sizeof(T)));
+        return static_cast<T*>(SlabPool<sizeof(T), alignof(T)>::Instance().Allocate());
+    }
+
+    void deallocate(T* p, std::size_t n) {
+        if (n != 1) {
+            ::operator delete(p);
+            return;
+        }
+        SlabPool<sizeof(T), alignof(T)>::Instance().Free(p);
+    }
+
+    template <class U>
+    bool operator==(const SlabAllocator<U>&) const { return true; }
+    template <class U>
+    bool operator!=(const SlabAllocator<U>&) const { return false; }
+};
+
+// 从 slab 池创建连接上下文
+template <class T, class... Args>
+std::shared_ptr<T> MakePooled(Args&&... args) {
+    return std::allocate_shared<T>(SlabAllocator<T>(), std::forward<Args>(args)...);
+}
+
+#endif // CONNECTION_POOL_H
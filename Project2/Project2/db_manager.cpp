@@ -1,20 +1,88 @@
 #include "db_manager.h"
 #include <iostream>
 #include <string>
+#include <thread>
 // MySQL Connector/C++ ͷļ
 #include "jdbc/mysql_driver.h"
-#include <jdbc/cppconn/statement.h>
 
 #define WIN32_LEAN_AND_MEAN
 using namespace std;
 using namespace sql;
 
+// ==========================================
+// ConnectionLease ʵ
+// ==========================================
+
+// MySQL ͻ˴루mysql  errmsg.h
+const int CR_SERVER_GONE_ERROR = 2006;
+const int CR_SERVER_LOST = 2013;
+
+bool IsConnectionError(const sql::SQLException& e) {
+    return e.getSQLState().compare(0, 2, "08") == 0
+        || e.getErrorCode() == CR_SERVER_GONE_ERROR
+        || e.getErrorCode() == CR_SERVER_LOST;
+}
+
+ConnectionLease::ConnectionLease(PooledConnection* pooled)
+    : pooled(pooled), broken(false) {
+}
+
+ConnectionLease::ConnectionLease(ConnectionLease&& other) noexcept
+    : pooled(other.pooled), broken(other.broken) {
+    other.pooled = nullptr;
+}
+
+ConnectionLease& ConnectionLease::operator=(ConnectionLease&& other) noexcept {
+    if (this != &other) {
+        Release();
+        pooled = other.pooled;
+        broken = other.broken;
+        other.pooled = nullptr;
+    }
+    return *this;
+}
+
+void ConnectionLease::Release() {
+    if (pooled == nullptr) return;
+    DBManager::GetInstance()->ReturnConnection(pooled, broken);
+    pooled = nullptr;
+    broken = false;
+}
+
+void ConnectionLease::InvalidateOnConnectionError() {
+    try {
+        throw;
+    }
+    catch (const sql::SQLException& e) {
+        if (IsConnectionError(e)) broken = true;
+    }
+    catch (...) {
+    }
+}
+
+PreparedStatement* ConnectionLease::Prepare(std::string_view sql) {
+    auto it = pooled->statements.find(sql);
+    if (it != pooled->statements.end()) {
+        // һʹµĲ뱾ִ
+        it->second->clearParameters();
+        return it->second.get();
+    }
+    std::unique_ptr<PreparedStatement> stmt(pooled->conn->prepareStatement(std::string(sql)));
+    PreparedStatement* result = stmt.get();
+    pooled->statements.emplace(std::string(sql), std::move(stmt));
+    return result;
+}
+
+// ==========================================
+// DBManager ʵ
+// ==========================================
+
 // ʼ̬Ա
 DBManager* DBManager::instance = nullptr;
 std::mutex DBManager::instance_mutex;
 
 // ˽й캯ʼ
-DBManager::DBManager() {
+DBManager::DBManager() : total_connections(0) {
     // 1. ݿãɸΪļȡ˴Ӳʾ
     db_host = "tcp://127.0.0.1:3306";
     db_name = "cpptestmysql";
@@ -34,6 +102,9 @@ DBManager::DBManager() {
         cerr << "[DBManager] ʼ쳣" << e.what() << endl;
         throw; // ׳ȷʼʧʱ˳
     }
+
+    // 3. ӳά̣߳٣߳˳
+    std::thread(&DBManager::MaintainLoop, this).detach();
 }
 
 // ͷɿֶɾ˴ǣ
@@ -52,69 +123,179 @@ DBManager* DBManager::GetInstance() {
     return instance;
 }
 
-// ȡݿӣضӣ߳ʹã
-Connection* DBManager::GetConnection() {
-    try {
-        if (driver == nullptr) {
-            throw runtime_error("MySQL δʼ");
+ConnectionLease DBManager::Acquire() {
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(DB_POOL_ACQUIRE_TIMEOUT_MS);
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    while (true) {
+        // 1. ÿӣչ黹ֱӽнϾõȼ飨Ѱ wait_timeout Ͽ
+        if (!idle_connections.empty()) {
+            PooledConnection* idle = idle_connections.back();
+            idle_connections.pop_back();
+            lock.unlock();
+
+            bool stale = chrono::steady_clock::now() - idle->lastUsed >= chrono::seconds(DB_POOL_VALIDATE_AFTER_SEC);
+            if (stale && !IsConnectionValid(idle->conn)) {
+                CloseConnection(idle);
+                lock.lock();
+                total_connections--;
+                continue;
+            }
+            return ConnectionLease(idle);
+        }
+
+        // 2. δʱ½ӣڼ䲻
+        if (total_connections < DB_POOL_MAX_SIZE) {
+            total_connections++;
+            lock.unlock();
+            try {
+                return ConnectionLease(CreateConnection());
+            }
+            catch (...) {
+                lock.lock();
+                total_connections--;
+                pool_cv.notify_one();
+                throw;
+            }
         }
 
-        // ӣÿ̵߳ʱضӣ
-        Connection* conn = driver->connect(db_host, db_user, db_pass);
-        if (conn == nullptr) {
-            throw runtime_error("ݿʧ");
+        // 3. ȫȴ黹
+        if (pool_cv.wait_until(lock, deadline) == std::cv_status::timeout &&
+            idle_connections.empty() && total_connections >= DB_POOL_MAX_SIZE) {
+            cerr << "[DBManager] ȴݿӳʱѽ " << total_connections << " " << endl;
+            throw sql::SQLException("ݿӳȴӳʱ");
         }
+    }
+}
+
+// ½Ӳã֮ڸãѡݿ
+PooledConnection* DBManager::CreateConnection() {
+    if (driver == nullptr) {
+        throw sql::SQLException("MySQL δʼ");
+    }
+
+    Connection* conn = driver->connect(db_host, db_user, db_pass);
+    if (conn == nullptr) {
+        throw sql::SQLException("ݿʧ");
+    }
 
+    try {
         // 
         conn->setSchema(db_name); // ѡݿ
         conn->setClientOption("connectTimeout", to_string(db_timeout)); // ʱ
         conn->setClientOption("charset", "utf8mb4"); // 
+    }
+    catch (...) {
+        delete conn;
+        throw;
+    }
+    return new PooledConnection(conn);
+}
 
-        // Ч
-        if (!IsConnectionValid(conn)) {
-            delete conn;
-            throw runtime_error("ӴɹЧ");
-        }
-
-        cout << "[DBManager] ݿӻȡɹ" << endl;
-        return conn;
+void DBManager::CloseConnection(PooledConnection* pooled) {
+    try {
+        pooled->statements.clear(); // ͷ
+        pooled->conn->close(); // ر
     }
     catch (const sql::SQLException& e) {
-        cerr << "[DBManager] ȡ쳣" << e.what()
-            << " (룺" << e.getErrorCode() << ")" << endl;
-        return nullptr;
-    }
-    catch (const runtime_error& e) {
-        cerr << "[DBManager] ȡʧܣ" << e.what() << endl;
-        return nullptr;
+        cerr << "[DBManager] ر쳣" << e.what() << endl;
     }
+    delete pooled->conn;   // ͷڴ
+    delete pooled;
 }
 
-// ͷݿӣʹã
-void DBManager::ReleaseConnection(Connection* conn) {
-    if (conn != nullptr) {
+void DBManager::ReturnConnection(PooledConnection* pooled, bool broken) {
+    Connection* conn = pooled->conn;
+    if (!broken) {
         try {
-            conn->close(); // ر
-            delete conn;   // ͷڴ
-            cout << "[DBManager] ݿͷ" << endl;
+            // ʹĵ߿ûлָԶύ
+            if (!conn->getAutoCommit()) {
+                conn->rollback();
+                conn->setAutoCommit(true);
+            }
+            broken = conn->isClosed();
         }
-        catch (const sql::SQLException& e) {
-            cerr << "[DBManager] ͷ쳣" << e.what() << endl;
+        catch (const sql::SQLException&) {
+            broken = true;
         }
     }
+
+    if (broken) {
+        CloseConnection(pooled);
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        total_connections--;
+        pool_cv.notify_one();
+        return;
+    }
+
+    pooled->lastUsed = chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    idle_connections.push_back(pooled);
+    pool_cv.notify_one();
+}
+
+void DBManager::MaintainLoop() {
+    while (true) {
+        // 1. տйõӣδõĿͷȡ
+        vector<PooledConnection*> expired;
+        int missing = 0;
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            auto now = chrono::steady_clock::now();
+            size_t count = 0;
+            while (count < idle_connections.size() &&
+                total_connections - static_cast<int>(expired.size()) > DB_POOL_MIN_SIZE &&
+                now - idle_connections[count]->lastUsed >= chrono::seconds(DB_POOL_IDLE_TIMEOUT_SEC)) {
+                expired.push_back(idle_connections[count]);
+                count++;
+            }
+            idle_connections.erase(idle_connections.begin(), idle_connections.begin() + count);
+            total_connections -= static_cast<int>(expired.size());
+
+            // 2. ʱԤȲ㣨ռסڼ䲻
+            if (total_connections < DB_POOL_MIN_SIZE) {
+                missing = DB_POOL_MIN_SIZE - total_connections;
+                total_connections += missing;
+            }
+        }
+        for (PooledConnection* pooled : expired) {
+            CloseConnection(pooled);
+        }
+
+        for (int i = 0; i < missing; ++i) {
+            PooledConnection* pooled = nullptr;
+            try {
+                pooled = CreateConnection();
+            }
+            catch (const sql::SQLException& e) {
+                cerr << "[DBManager] Ԥʧܣ" << e.what()
+                    << " (룺" << e.getErrorCode() << ")" << endl;
+            }
+            if (pooled != nullptr) {
+                ReturnConnection(pooled, false);
+            }
+            else {
+                std::lock_guard<std::mutex> lock(pool_mutex);
+                total_connections--;
+                pool_cv.notify_one();
+            }
+        }
+        if (missing > 0 || !expired.empty()) {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            cout << "[DBManager] ӳأ " << total_connections << "  " << idle_connections.size() << " " << endl;
+        }
+
+        this_thread::sleep_for(chrono::seconds(DB_POOL_MAINTAIN_INTERVAL_SEC));
+    }
 }
 
-// ǷЧִмSQL֤
+// ǷЧping ִвѯ
 bool DBManager::IsConnectionValid(Connection* conn) {
     if (conn == nullptr) return false;
     try {
-        Statement* stmt = conn->createStatement();
-        stmt->executeQuery("SELECT 1"); // ִм򵥲ѯ
-        delete stmt;
-        return true;
+        return conn->isValid();
     }
     catch (const sql::SQLException& e) {
         cerr << "[DBManager] Ч" << e.what() << endl;
         return false;
     }
-}
\ No newline at end of file
+}
@@ -4,13 +4,86 @@
 #define WIN32_LEAN_AND_MEAN
 #include <string>
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
 // MySQL Connector/C++ ͷļ
 #include <jdbc/cppconn/connection.h>
 #include <jdbc/cppconn/exception.h>
+#include <jdbc/cppconn/prepared_statement.h>
 #include "jdbc/mysql_driver.h"
 using namespace sql;
 
-// ݿӹࣨģʽ
+// ӳ
+const int DB_POOL_MIN_SIZE = 2;                 // פ̨̲߳㣬һ󲻱صȴ
+const int DB_POOL_MAX_SIZE = 16;                // ͬʱڵޣ + У
+const int DB_POOL_ACQUIRE_TIMEOUT_MS = 5000;    // ȫʱȴ黹ʱ
+const int DB_POOL_IDLE_TIMEOUT_SEC = 300;       // гʱӱرգٱ DB_POOL_MIN_SIZE 
+const int DB_POOL_VALIDATE_AFTER_SEC = 30;      // гʱӽǰȼǷȻЧ
+const int DB_POOL_MAINTAIN_INTERVAL_SEC = 30;   // ̨̻߳/ӵļ
+
+class DBManager;
+
+//  SQL ıһʱع std::string
+struct SqlTextHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view sql) const { return std::hash<std::string_view>()(sql); }
+};
+
+// еһӣͬԤ仺һã˵ prepare ÿֻһ
+struct PooledConnection {
+    Connection* conn;
+    std::unordered_map<std::string, std::unique_ptr<PreparedStatement>, SqlTextHash, std::equal_to<>> statements;
+    std::chrono::steady_clock::time_point lastUsed;
+
+    explicit PooledConnection(Connection* conn) : conn(conn), lastUsed(std::chrono::steady_clock::now()) {}
+};
+
+// ӼSQLSTATE 08 ࣨ쳣ͻ˴ 2006/2013ϿѯӶʧ
+bool IsConnectionError(const sql::SQLException& e);
+
+// ԼRAIIʱӹ黹ӳأ߲ delete ӡ
+// 黹ʱعδύԼͻͨ SQL ӰӣճŻسС
+// Ӽɵ catch е InvalidateOnConnectionError黹ʱֱӹر
+class ConnectionLease {
+public:
+    ConnectionLease() : pooled(nullptr), broken(false) {}
+    ConnectionLease(ConnectionLease&& other) noexcept;
+    ConnectionLease& operator=(ConnectionLease&& other) noexcept;
+    ~ConnectionLease() { Release(); }
+    ConnectionLease(const ConnectionLease&) = delete;
+    ConnectionLease& operator=(const ConnectionLease&) = delete;
+
+    Connection* get() const { return pooled ? pooled->conn : nullptr; }
+    Connection* operator->() const { return pooled->conn; }
+    Connection& operator*() const { return *pooled->conn; }
+    explicit operator bool() const { return pooled != nullptr; }
+
+    // ȡϻԤ䣨״ʹʱ prepareֻ֮ղ
+    // У߲Ҫ deleteֻı̶ SQLƴӵ SQL  prepareStatement
+    PreparedStatement* Prepare(std::string_view sql);
+
+    // ǰ黹
+    void Release();
+
+    // 𻵣黹ʱرնŻس
+    void Invalidate() { broken = true; }
+
+    //  catch еãǰ쳣Ӽʱ
+    void InvalidateOnConnectionError();
+
+private:
+    friend class DBManager;
+    explicit ConnectionLease(PooledConnection* pooled);
+
+    PooledConnection* pooled;
+    bool broken;
+};
+
+// ݿӹࣨģʽڲά޵ӳ
 class DBManager {
 private:
     // ʵ̬
@@ -28,6 +101,12 @@ private:
     // MySQL ȫΨһ
     mysql::MySQL_Driver* driver;
 
+    // ӳ״̬ pool_mutex 
+    std::mutex pool_mutex;
+    std::condition_variable pool_cv;                // ӹ黹ճʱ֪ͨȴ
+    std::vector<PooledConnection*> idle_connections; // ȳ黹ĩβڲõڿͷȴ
+    int total_connections;                          // ѽڽ + 
+
     // ˽й캯ֹⲿʵ
     DBManager();
     // ˽ֹⲿ٣
@@ -36,18 +115,29 @@ private:
     DBManager(const DBManager&) = delete;
     DBManager& operator=(const DBManager&) = delete;
 
+    friend class ConnectionLease;
+
+    // ½һӣʧʱ׳ sql::SQLException
+    PooledConnection* CreateConnection();
+    // ͷŻ䣬ٹر
+    void CloseConnection(PooledConnection* pooled);
+
+    // Լ黹ӣδĻعָԶύ𻵵ӹرղó
+    void ReturnConnection(PooledConnection* pooled, bool broken);
+
+    // ̨̣߳رտйõӣʱ
+    void MaintainLoop();
+
 public:
     // ȫֻȡʵ
     static DBManager* GetInstance();
 
-    // ȡݿӣضӣֶͷţ
-    Connection* GetConnection();
-
-    // ͷݿӣѡʹӳأ˴Ϊ黹ӣ
-    void ReleaseConnection(Connection* conn);
+    // ӳؽӣȸ黹Ŀӣûʱ½ﵽʱȴ黹
+    // ݿⲻûȴʱʱ׳ sql::SQLExceptionֱ connect ʧܵΪһ£
+    ConnectionLease Acquire();
 
-    // ǷЧ
+    // ǷЧֻԿнϾõӵã
     bool IsConnectionValid(Connection* conn);
 };
 
-#endif // DB_MANAGER_H
\ No newline at end of file
+#endif // DB_MANAGER_H
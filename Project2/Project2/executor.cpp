@@ -0,0 +1,184 @@
+﻿#include "executor.h"
+#include <iostream>
+#include <climits>
+
+WorkStealingExecutor* g_pExecutor = nullptr;
+
+thread_local WorkStealingExecutor* WorkStealingExecutor::s_executor = nullptr;
+thread_local int WorkStealingExecutor::s_workerIndex = -1;
+
+WorkStealingExecutor::WorkStealingExecutor(int workerCount)
+    : isRunning(false), idleWorkers(0), nextWorker(0), steals(0) {
+    if (workerCount < 1) workerCount = 1;
+    for (int i = 0; i < workerCount; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    hWakeSemaphore = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+    Stop();
+    if (hWakeSemaphore != NULL) {
+        CloseHandle(hWakeSemaphore);
+    }
+}
+
+struct WorkerStartParam {
+    WorkStealingExecutor* executor;
+    int index;
+};
+
+DWORD WINAPI WorkStealingExecutor::WorkerThreadProc(LPVOID lpParam) {
+    WorkerStartParam* param = static_cast<WorkerStartParam*>(lpParam);
+    WorkStealingExecutor* executor = param->executor;
+    int index = param->index;
+    delete param;
+
+    s_executor = executor;
+    s_workerIndex = index;
+    executor->Run(index);
+    return 0;
+}
+
+bool WorkStealingExecutor::Start() {
+    if (isRunning) return true;
+    if (hWakeSemaphore == NULL) {
+        std::cerr << "[执行器创建信号量失败] 错误码: " << GetLastError() << std::endl;
+        return false;
+    }
+    isRunning = true;
+
+    for (int i = 0; i < WorkerCount(); ++i) {
+        WorkerStartParam* param = new WorkerStartParam{ this, i };
+        HANDLE hThread = CreateThread(NULL, 0, WorkerThreadProc, param, 0, NULL);
+        if (hThread == NULL) {
+            std::cerr << "[线程创建失败] 错误码: " << GetLastError() << std::endl;
+            delete param;
+            Stop();
+            return false;
+        }
+        workerThreads.push_back(hThread);
+    }
+    return true;
+}
+
+void WorkStealingExecutor::Stop() {
+    if (!isRunning.exchange(false)) return;
+
+    // 唤醒所有休眠的工作线程，它们执行完剩余任务后退出
+    ReleaseSemaphore(hWakeSemaphore, static_cast<LONG>(workerThreads.size()), NULL);
+    if (!workerThreads.empty()) {
+        WaitForMultipleObjects(
+            static_cast<DWORD>(workerThreads.size()),
+            workerThreads.data(),
+            TRUE,
+            INFINITE
+        );
+    }
+    for (HANDLE hThread : workerThreads) {
+        CloseHandle(hThread);
+    }
+    workerThreads.clear();
+
+    // 与 Stop 并发的 Submit 可能在工作线程最后一次检查队列之后才入队，由停止线程执行掉；
+    // 之后的 Submit 在队列锁内看到已停止，返回 false 由调用方处理
+    Task task;
+    for (int i = 0; i < WorkerCount(); ++i) {
+        while (PopLocal(i, task)) {
+            Execute(task);
+        }
+    }
+
+    std::cout << "[执行器已停止] 任务窃取次数: " << steals.load() << std::endl;
+}
+
+bool WorkStealingExecutor::Submit(Task&& task) {
+    if (!task) return false;
+
+    int index;
+    if (s_executor == this) {
+        index = s_workerIndex;
+    }
+    else {
+        index = static_cast<int>(nextWorker.fetch_add(1) % workers.size());
+    }
+    {
+        // 在队列锁内检查运行状态：Stop 在工作线程退出后持同一把锁取出剩余任务，入队的任务不会无人执行
+        std::lock_guard<std::mutex> lk(workers[index]->mutex);
+        if (!isRunning) return false;
+        workers[index]->tasks.push_back(std::move(task));
+    }
+
+    // 有线程在休眠时唤醒一个；休眠前线程会再检查一遍所有队列，因此不会丢失唤醒
+    if (idleWorkers.load() > 0) {
+        ReleaseSemaphore(hWakeSemaphore, 1, NULL);
+    }
+    return true;
+}
+
+bool WorkStealingExecutor::PopLocal(int index, Task& task) {
+    Worker& w = *workers[index];
+    std::lock_guard<std::mutex> lk(w.mutex);
+    if (w.tasks.empty()) return false;
+    task = std::move(w.tasks.front());
+    w.tasks.pop_front();
+    return true;
+}
+
+// 从其他工作线程的队尾窃取一个任务，和队列主人取任务的一端错开
+bool WorkStealingExecutor::Steal(int thief, Task& task) {
+    int count = WorkerCount();
+    for (int i = 1; i < count; ++i) {
+        Worker& victim = *workers[(thief + i) % count];
+        std::lock_guard<std::mutex> lk(victim.mutex);
+        if (victim.tasks.empty()) continue;
+        task = std::move(victim.tasks.back());
+        victim.tasks.pop_back();
+        steals++;
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingExecutor::Execute(Task& task) {
+    try {
+        task();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[任务异常] " << e.what() << std::endl;
+    }
+    catch (...) {
+        std::cerr << "[任务异常] 未知异常" << std::endl;
+    }
+}
+
+void WorkStealingExecutor::Run(int index) {
+    while (true) {
+        Task task;
+        if (PopLocal(index, task) || Steal(index, task)) {
+            Execute(task);
+            continue;
+        }
+        if (!isRunning) break;
+
+        // 先登记为空闲再检查一遍队列：提交方入队后看到空闲线程就会释放信号量
+        idleWorkers++;
+        if (PopLocal(index, task) || Steal(index, task)) {
+            idleWorkers--;
+            Execute(task);
+            continue;
+        }
+        if (!isRunning) {
+            idleWorkers--;
+            break;
+        }
+        WaitForSingleObject(hWakeSemaphore, INFINITE);
+        idleWorkers--;
+    }
+}
+
+void PostBackgroundTask(WorkStealingExecutor::Task task) {
+    WorkStealingExecutor* executor = g_pExecutor;
+    if (executor != nullptr && executor->Submit(std::move(task))) return;
+    if (task) task();
+}
@@ -0,0 +1,67 @@
+﻿#pragma once
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// 工作窃取执行器：每个工作线程有自己的任务双端队列，
+// 自己从队首取任务（保持提交顺序），空闲时从其他线程的队尾窃取；
+// 所有队列都为空时在信号量上休眠，有新任务才被唤醒，不做定时轮询。
+// 请求处理、告警通知和数据库回写任务都运行在同一个执行器上。
+class WorkStealingExecutor {
+public:
+    typedef std::function<void()> Task;
+
+    explicit WorkStealingExecutor(int workerCount);
+    ~WorkStealingExecutor();
+
+    bool Start();
+    // 停止接收新任务，执行完已提交的任务后退出
+    void Stop();
+
+    // 提交任务：工作线程提交的任务进入自己的队列，外部线程提交的任务轮流分给各工作线程
+    bool Submit(Task&& task);
+
+    bool IsRunning() const { return isRunning; }
+    int WorkerCount() const { return static_cast<int>(workers.size()); }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    static DWORD WINAPI WorkerThreadProc(LPVOID lpParam);
+    void Run(int index);
+    bool PopLocal(int index, Task& task);
+    bool Steal(int thief, Task& task);
+    void Execute(Task& task);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<HANDLE> workerThreads;
+    HANDLE hWakeSemaphore;              // 唤醒休眠的工作线程
+    std::atomic<bool> isRunning;
+    std::atomic<int> idleWorkers;       // 正在或即将休眠的工作线程数
+    std::atomic<unsigned> nextWorker;   // 外部提交的轮转位置
+    std::atomic<uint64_t> steals;       // 窃取成功次数
+
+    // 当前线程所属的执行器及其工作线程编号（非工作线程为 nullptr / -1）
+    static thread_local WorkStealingExecutor* s_executor;
+    static thread_local int s_workerIndex;
+};
+
+// 后台任务使用的全局执行器（由处理线程池启动时设置）
+extern WorkStealingExecutor* g_pExecutor;
+
+// 把任务交给全局执行器；执行器未启动或已停止时在调用线程上直接执行
+void PostBackgroundTask(WorkStealingExecutor::Task task);
+
+#endif // EXECUTOR_H
@@ -0,0 +1,46 @@
+﻿#include "frame_compress.h"
+#include <zlib.h>
+
+namespace {
+
+// 原始长度前缀的字节数
+const std::size_t RAW_LENGTH_BYTES = 4;
+
+} // namespace
+
+bool CompressFrame(const std::string& frame, std::string& out) {
+    const std::size_t rawLength = frame.size() - ChatMessage::header_length;
+    uLongf packedLength = compressBound(static_cast<uLong>(rawLength));
+
+    out.resize(ChatMessage::header_length + RAW_LENGTH_BYTES + packedLength);
+    char* prefix = &out[ChatMessage::header_length];
+    prefix[0] = static_cast<char>((rawLength >> 24) & 0xFF);
+    prefix[1] = static_cast<char>((rawLength >> 16) & 0xFF);
+    prefix[2] = static_cast<char>((rawLength >> 8) & 0xFF);
+    prefix[3] = static_cast<char>(rawLength & 0xFF);
+
+    int rc = compress2(reinterpret_cast<Bytef*>(prefix + RAW_LENGTH_BYTES), &packedLength,
+        reinterpret_cast<const Bytef*>(frame.data() + ChatMessage::header_length),
+        static_cast<uLong>(rawLength), FRAME_COMPRESS_LEVEL);
+    if (rc != Z_OK || RAW_LENGTH_BYTES + packedLength >= rawLength) {
+        return false;
+    }
+    out.resize(ChatMessage::header_length + RAW_LENGTH_BYTES + packedLength);
+    return true;
+}
+
+bool DecompressBody(const std::string& body, std::string& out) {
+    if (body.size() < RAW_LENGTH_BYTES) return false;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(body.data());
+    std::size_t rawLength = (static_cast<std::size_t>(p[0]) << 24) | (static_cast<std::size_t>(p[1]) << 16) |
+        (static_cast<std::size_t>(p[2]) << 8) | static_cast<std::size_t>(p[3]);
+    // 原始长度同样受帧长度上限约束，防止以极小的压缩包申请大块内存
+    if (rawLength > ChatMessage::max_frame_length()) return false;
+
+    out.resize(rawLength);
+    uLongf outLength = static_cast<uLongf>(rawLength);
+    int rc = uncompress(reinterpret_cast<Bytef*>(&out[0]), &outLength,
+        reinterpret_cast<const Bytef*>(body.data() + RAW_LENGTH_BYTES),
+        static_cast<uLong>(body.size() - RAW_LENGTH_BYTES));
+    return rc == Z_OK && outLength == rawLength;
+}
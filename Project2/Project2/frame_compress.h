@@ -0,0 +1,23 @@
+﻿#pragma once
+#ifndef FRAME_COMPRESS_H
+#define FRAME_COMPRESS_H
+
+#include <string>
+#include "base.h"
+
+// 登录时协商压缩后，消息体达到该长度才压缩（小帧压缩收益抵不上 CPU 开销）
+const std::size_t FRAME_COMPRESS_THRESHOLD = 1024;
+
+// zlib 压缩级别：发送路径上优先保证延迟
+const int FRAME_COMPRESS_LEVEL = 1;
+
+// 压缩由 BeginFrame 开始的帧：out 为同样预留了消息头位置的新帧，
+// 消息体为 4 字节大端原始长度 + zlib 数据（对应 ChatMessage::v4_flag_deflate）。
+// 压缩失败或压缩后不比原来小时返回 false，调用方按原样发送
+bool CompressFrame(const std::string& frame, std::string& out);
+
+// 解压带 v4_flag_deflate 标志的消息体。原始长度超过 ChatMessage::max_frame_length()
+// 或数据损坏时返回 false
+bool DecompressBody(const std::string& body, std::string& out);
+
+#endif // FRAME_COMPRESS_H
@@ -0,0 +1,129 @@
+﻿#include "frame_decoder.h"
+#include <algorithm>
+#include <cstring>
+
+FrameDecoder::FrameDecoder()
+    : buffer(inlineBuffer), capacity(FRAME_INLINE_SIZE), head(0), size(0) {
+}
+
+FrameDecoder::~FrameDecoder() {
+    ReleasePooled();
+}
+
+int FrameDecoder::WritableSegments(FrameSegment segments[2]) {
+    std::size_t free = capacity - size;
+    if (free == 0) return 0;
+
+    std::size_t tail = (head + size) % capacity;
+    std::size_t first = (std::min)(free, capacity - tail);
+    segments[0].data = buffer + tail;
+    segments[0].len = first;
+    if (first == free) return 1;
+
+    segments[1].data = buffer;
+    segments[1].len = free - first;
+    return 2;
+}
+
+void FrameDecoder::Commit(std::size_t n) {
+    size += (std::min)(n, Writable());
+}
+
+FrameDecoder::Result FrameDecoder::Next(std::string& body, std::size_t maxBodyLength, int* version, uint32_t* flags) {
+    if (size < ChatMessage::header_length) return Result::NeedMore;
+
+    // 解析消息头获取消息体长度
+    char header[ChatMessage::header_length];
+    Peek(0, header, ChatMessage::header_length);
+    std::size_t bodyLength = 0;
+    int frameVersion = ChatMessage::frame_v3;
+    uint32_t frameFlags = 0;
+    if (!ChatMessage::parse_header(header, bodyLength, &frameVersion, &frameFlags)) {
+        return Result::BadHeader;
+    }
+    if (bodyLength > maxBodyLength) {
+        return Result::TooLarge;
+    }
+
+    std::size_t frameLength = ChatMessage::header_length + bodyLength;
+    if (size < frameLength) {
+        // 大帧超过缓冲区容量时从缓冲区池借用更大的缓冲区，否则永远收不全。
+        // 只在缓冲区已被收到的数据填满时按倍数扩大，不按消息头声明的长度一次借足：
+        // 占用的内存与实际收到的字节数成正比，只发消息头的连接不会占住大块内存
+        if (frameLength > capacity && size == capacity) {
+            Grow((std::min)(frameLength, capacity * 2));
+        }
+        return Result::NeedMore;
+    }
+    if (version) *version = frameVersion;
+    if (flags) *flags = frameFlags;
+
+    body.resize(bodyLength);
+    Peek(ChatMessage::header_length, &body[0], bodyLength);
+    Skip(ChatMessage::header_length + bodyLength);
+    return Result::Frame;
+}
+
+void FrameDecoder::TakeBuffered(std::string& out) {
+    out.resize(size);
+    if (size > 0) {
+        Peek(0, &out[0], size);
+        Skip(size);
+    }
+}
+
+void FrameDecoder::Append(const char* data, std::size_t n) {
+    if (n > Writable()) Grow(size + n);
+    FrameSegment segments[2];
+    int count = WritableSegments(segments);
+    std::size_t copied = 0;
+    for (int i = 0; i < count && copied < n; ++i) {
+        std::size_t len = (std::min)(segments[i].len, n - copied);
+        std::memcpy(segments[i].data, data + copied, len);
+        copied += len;
+    }
+    Commit(copied);
+}
+
+void FrameDecoder::Peek(std::size_t offset, char* out, std::size_t n) const {
+    std::size_t start = (head + offset) % capacity;
+    std::size_t first = (std::min)(n, capacity - start);
+    std::memcpy(out, buffer + start, first);
+    if (first < n) {
+        std::memcpy(out + first, buffer, n - first);
+    }
+}
+
+void FrameDecoder::Skip(std::size_t n) {
+    head = (head + n) % capacity;
+    size -= n;
+    // 缓冲区读空时回到起点，后续读取尽量落在一段连续内存中
+    if (size == 0) {
+        head = 0;
+    }
+    // 剩余数据放得进内联缓冲区时搬回并归还借来的大缓冲区：
+    // 大帧之后紧跟着流水线发来的小请求时，连接不会一直占着大块内存
+    if (UsingPooledBuffer() && size <= FRAME_INLINE_SIZE) {
+        Peek(0, inlineBuffer, size);
+        ReleasePooled();
+        head = 0;
+    }
+}
+
+// 从缓冲区池借一块更大的缓冲区，并把已缓存的数据整理到开头
+void FrameDecoder::Grow(std::size_t required) {
+    std::size_t largerCapacity = 0;
+    char* larger = BufferPool::Instance().Acquire(required, largerCapacity);
+    Peek(0, larger, size);
+    ReleasePooled();
+    buffer = larger;
+    capacity = largerCapacity;
+    head = 0;
+}
+
+void FrameDecoder::ReleasePooled() {
+    if (!UsingPooledBuffer()) return;
+    BufferPool::Instance().Release(buffer, capacity);
+    buffer = inlineBuffer;
+    capacity = FRAME_INLINE_SIZE;
+}
@@ -0,0 +1,73 @@
+﻿#pragma once
+#ifndef FRAME_DECODER_H
+#define FRAME_DECODER_H
+
+#include <string>
+#include "base.h"
+#include "buffer_pool.h"
+
+// 每连接内联接收缓冲区大小：登录、心跳、预警增删改等常见请求都远小于此，
+// 空闲连接不再各自占用一整块大缓冲区。遇到更大的帧时随数据到达逐级从共享缓冲区池借用更大的块，
+// 取出帧后剩余的数据放得进内联缓冲区时立即归还并退回内联缓冲区
+const std::size_t FRAME_INLINE_SIZE = 1024;
+
+// 登录前允许的最大消息体长度：未登录的连接不能凭一个消息头让服务器为它准备大缓冲区
+const std::size_t PREAUTH_MAX_BODY_LENGTH = 64 * 1024;
+
+// 环形缓冲区中的一段连续内存
+struct FrameSegment {
+    char* data;
+    std::size_t len;
+};
+
+// ChatMessage 帧解码器：
+// socket 一次读取尽可能多的数据到环形缓冲区，再一次性取出其中所有完整的帧，
+// 不完整的帧留在缓冲区等待下次读取。短读不会破坏数据流，客户端流水线发送的
+// 多条请求也只需一次系统调用。仅由所属 I/O 线程访问，无需加锁。
+class FrameDecoder {
+public:
+    enum class Result {
+        Frame,      // 取出了一个完整帧
+        NeedMore,   // 数据不足一帧，等待下次读取
+        BadHeader,  // 消息头非法，连接应关闭
+        TooLarge    // 消息体长度超过调用方允许的上限，连接应关闭
+    };
+
+    FrameDecoder();
+    ~FrameDecoder();
+    FrameDecoder(const FrameDecoder&) = delete;
+    FrameDecoder& operator=(const FrameDecoder&) = delete;
+
+    // 获取可写区域（最多两段：缓冲区尾部的空闲空间和环绕到开头的空闲空间），返回段数
+    int WritableSegments(FrameSegment segments[2]);
+
+    // 向可写区域写入 n 字节后调用
+    void Commit(std::size_t n);
+
+    // 取出下一个完整帧的消息体，消息体长度不得超过 maxBodyLength；
+    // version 非空时输出帧版本，flags 非空时输出 v4 标志位
+    Result Next(std::string& body, std::size_t maxBodyLength, int* version = nullptr, uint32_t* flags = nullptr);
+
+    // 热升级交接用：取出全部已缓存但尚未组成完整帧的字节 / 把交接来的字节放回缓冲区
+    void TakeBuffered(std::string& out);
+    void Append(const char* data, std::size_t n);
+
+    std::size_t Readable() const { return size; }
+    std::size_t Writable() const { return capacity - size; }
+    bool UsingPooledBuffer() const { return buffer != inlineBuffer; }
+
+private:
+    // 从读位置偏移 offset 处复制 n 字节（处理环绕）
+    void Peek(std::size_t offset, char* out, std::size_t n) const;
+    void Skip(std::size_t n);
+    void Grow(std::size_t required);
+    void ReleasePooled();
+
+    char inlineBuffer[FRAME_INLINE_SIZE];
+    char* buffer;           // 指向 inlineBuffer 或从 BufferPool 借来的缓冲区
+    std::size_t capacity;
+    std::size_t head;       // 读位置
+    std::size_t size;   // 已缓存的字节数
+};
+
+#endif // FRAME_DECODER_H
@@ -5,12 +5,18 @@
 
 #include <iostream>
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
-#include <functional>
 #include "nlohmann/json.hpp"  // 使用nlohmann/json库处理JSON
 #include <mysql/jdbc.h>
+#include "db_manager.h"
+#include "warning_writer.h"
 #include "thread_local.h"
+#include "reactor.h"
 #include "MduserHandler.h"
+#include "request_types.h"
+#include "request_parser.h"
+#include "request_job.h"
 #define WIN32_LEAN_AND_MEAN
 using json = nlohmann::json;
 
@@ -19,16 +25,84 @@ using json = nlohmann::json;
 #include <atomic>
 #include <mutex>
 #include <chrono>
+#include <charconv>
+
+// 查询预警单分页配置
+const int QUERY_PAGE_SIZE = 100;         // 默认每页条数（每页一条响应帧）
+const int QUERY_PAGE_SIZE_V3 = 15;       // v3 帧消息体上限 4KB，每页条数（默认值与上限）需更小
+const int QUERY_MAX_PAGE_SIZE = 500;     // v4 帧客户端可指定的最大每页条数
+
+// 批量请求（batch）单帧最多携带的子请求数
+const std::size_t BATCH_MAX_REQUESTS = 200;
+
+// 固定结构的通用响应（成功时最多带一个整数字段）。
+// 热点请求的处理函数返回它，由 JsonWriter 直接写入发送帧，不构造 json 对象；
+// batch 等仍需 DOM 的地方用 ToJson 转换
+struct SimpleResponse {
+    std::string requestId;
+    const char* requestType = "";
+    int errorCode = 0;
+    std::string hint;
+    const char* dataKey = nullptr;      // 成功响应 data 中的字段（如 order_id），为空时不带 data
+    long long dataValue = 0;
+
+    static SimpleResponse Success(const std::string& requestId, const char* requestType,
+                                  const char* dataKey = nullptr, long long dataValue = 0) {
+        SimpleResponse r;
+        r.requestId = requestId;
+        r.requestType = requestType;
+        r.dataKey = dataKey;
+        r.dataValue = dataValue;
+        return r;
+    }
 
-// 前置声明处理函数
-class FuturesAlertServer;
-using RequestHandler = std::function<json(FuturesAlertServer&, const json&)>;
+    static SimpleResponse Error(const std::string& requestId, const char* requestType,
+                                int errorCode, std::string hint = "") {
+        SimpleResponse r;
+        r.requestId = requestId;
+        r.requestType = requestType;
+        r.errorCode = errorCode;
+        r.hint = std::move(hint);
+        return r;
+    }
+
+    // 字段与 createSuccessResponse / createErrorResponse 生成的响应一致
+    void Write(JsonWriter& w) const {
+        w.BeginObject()
+            .Field("type", "response")
+            .Field("request_id", requestId)
+            .Field("request_type", requestType)
+            .Field("status", errorCode == 0 ? 0 : 1)
+            .Field("error_code", errorCode);
+        if (errorCode != 0 && !hint.empty()) {
+            w.Key("data").BeginObject().Field("hint", hint).EndObject();
+        }
+        else if (errorCode == 0 && dataKey != nullptr) {
+            w.Key("data").BeginObject().Field(dataKey, dataValue).EndObject();
+        }
+        w.EndObject();
+    }
+
+    json ToJson() const {
+        json resp = {
+            {"type", "response"},
+            {"request_id", requestId},
+            {"request_type", requestType},
+            {"status", errorCode == 0 ? 0 : 1},
+            {"error_code", errorCode}
+        };
+        if (errorCode != 0 && !hint.empty()) {
+            resp["data"] = { {"hint", hint} };
+        }
+        else if (errorCode == 0 && dataKey != nullptr) {
+            resp["data"] = { {dataKey, dataValue} };
+        }
+        return resp;
+    }
+};
 
 class FuturesAlertServer {
 private:
-    // 路由映射表：请求类型 -> 处理函数
-    std::unordered_map<std::string, RequestHandler> requestHandlers;
-
     // 用于每个已登录用户的守护线程控制（token -> stop flag）
     inline static std::unordered_map<std::string, std::shared_ptr<std::atomic<bool>>> userWatchers;
     inline static std::mutex userWatchersMutex;
@@ -84,7 +158,9 @@ private:
 
     // 启动用户守护线程（token 唯一标识），线程生命周期由客户端连接控制：
     // 在客户端断开时应调用 stopUserWatcher(token) 来结束守护线程。
-    static void startUserWatcher(const std::string& token, const std::string& username) {
+    // client 以 weak_ptr 传入：守护线程不在处理线程上运行，不能依赖线程局部的当前客户端
+    static void startUserWatcher(const std::string& token, const std::string& username,
+        std::weak_ptr<ClientContext> client) {
         std::lock_guard<std::mutex> lk(userWatchersMutex);
         if (userWatchers.find(token) != userWatchers.end()) return; // 已有守护线程
 
@@ -92,7 +168,7 @@ private:
         userWatchers[token] = stopFlag;
 
         // 启动后台线程轮询数据库
-        std::thread([token, username, stopFlag]() {
+        std::thread([token, username, stopFlag, client]() {
             // 创建行情处理器实例
             CMduserHandler& handler = CMduserHandler::GetHandler();
             // 连接并登录行情服务器
@@ -102,13 +178,11 @@ private:
 				// 最新行情缓存,之后和数据库对比
                 unordered_map<string, double> m_lastPrices = handler.m_lastPrices;
                 
+                ConnectionLease conn;
                 try {
-                    std::unique_ptr<sql::Connection> conn(getConn());
+                    conn = getConn();
                     if (conn) {
-                        conn->setSchema("cpptestmysql");
-                        std::unique_ptr<sql::PreparedStatement> stmt(
-                            conn->prepareStatement("SELECT orderId, symbol, max_price, min_price, trigger_time, state FROM alert_order WHERE account=? AND state=0")
-                        );
+                        sql::PreparedStatement* stmt = conn.Prepare("SELECT orderId, symbol, max_price, min_price, trigger_time, state FROM alert_order WHERE account=? AND state=0");
                         stmt->setString(1, username);
                         //查询了未处理的预警单
                         std::unique_ptr<sql::ResultSet> res(stmt->executeQuery());
@@ -120,7 +194,7 @@ private:
                         if (order.size() > 0) {
                             for (auto it = m_lastPrices.begin(); it != m_lastPrices.end(); ++it) {
                             
-                                CheckAlert(order[0].symbol, it->second, order);
+                                CheckAlert(client, order[0].symbol, it->second, order);
                             }
                             
                         }
@@ -129,6 +203,7 @@ private:
                     }
                 }
                 catch (sql::SQLException& e) {
+                    conn.InvalidateOnConnectionError();
                     std::cerr << "[守护线程] 数据库异常: " << e.what() << std::endl;
                 }
                 catch (...) {
@@ -150,10 +225,13 @@ private:
     static std::vector<AlertOrder> LoadAlertOrders(std::unique_ptr<sql::ResultSet> res)
     {
         std::vector<AlertOrder> orders;
+        // 已确认但状态尚未回写的单子在数据库中仍是 state=0，不再重复推送
+        std::unordered_set<long long> pendingIds = AlertStateWriter::Instance().PendingSnapshot();
         try {
             while (res && res->next()) {
                 AlertOrder a;
                 a.orderId = res->getInt("orderId");
+                if (pendingIds.count(a.orderId)) continue;
                 a.symbol = res->getString("symbol");
                 // 如果数据库字段可能为 NULL，使用 isNull 检查
                 if (res->isNull("max_price")) a.max_price = 0.0;
@@ -177,7 +255,7 @@ private:
         return orders;
     }
 
-    static void CheckAlert(const string& symbol, double price, vector<AlertOrder> alerts)
+    static void CheckAlert(const std::weak_ptr<ClientContext>& clientRef, const string& symbol, double price, vector<AlertOrder> alerts)
     {
         
         // 获取当前时间 - 使用安全的 localtime_s
@@ -235,62 +313,38 @@ private:
 
             if (triggered)
             {
-                //SendResponse(ThreadLocalUser::GetClient(), responseData)
-                ClientContext* client = ThreadLocalUser::GetClient();
-                if (!client) {
+                std::shared_ptr<ClientContext> client = clientRef.lock();
+                if (!client || client->closed) {
                     // 无有效客户端上下文则跳过发送
                     continue;
                 }
 
                 // 构造唯一 alert_id（可按需替换为更复杂的生成策略）
-                string alertId = "msg_" + to_string(a.orderId) + "_" + to_string((long)now);
-
-                // 构造 JSON 响应 (符合 protocol.md alert_triggered 格式)
-                json j = {
-                    {"type", "alert_triggered"},
-                    {"alert_id", alertId},
-                    {"order_id", to_string(a.orderId)},
-                    {"symbol", a.symbol},
-                    {"trigger_value", price},
-                    {"trigger_time", current_time_str}
-                };
-
-                string responseData = j.dump();
-
-                // 发送响应（忽略返回值或根据需要记录）
-                SendResponse(client, responseData);
+                char alertId[48];
+                snprintf(alertId, sizeof(alertId), "msg_%lld_%ld", static_cast<long long>(a.orderId), static_cast<long>(now));
+
+                // 直接把推送写入发送帧 (符合 protocol.md alert_triggered 格式)，
+                // 价格剧烈波动时大量推送不再各自构造 json 对象和临时字符串
+                char orderIdText[24];
+                auto orderIdEnd = std::to_chars(orderIdText, orderIdText + sizeof(orderIdText), a.orderId).ptr;
+                std::string frame;
+                BeginFrame(frame);
+                JsonWriter writer(frame, client->bodyEncoding);
+                writer.BeginObject()
+                    .Field("type", "alert_triggered")
+                    .Field("alert_id", alertId)
+                    .Field("order_id", std::string_view(orderIdText, orderIdEnd - orderIdText))
+                    .Field("symbol", a.symbol)
+                    .Field("trigger_value", price)
+                    .Field("trigger_time", current_time_str)
+                    .EndObject();
+
+                // 告警推送优先发送，不必排在正在下发的预警列表等大块响应之后
+                client->loop->SendFrame(client.get(), std::move(frame), SendPriority::Alert);
             }
         }
     }
 
-    static bool SendResponse(ClientContext* client, const std::string& responseData) {
-        // 检查响应长度
-        if (responseData.size() > client->writeMsg.max_body_length) {
-            std::cerr << "[响应过长] 超过最大长度: " << client->writeMsg.max_body_length << std::endl;
-            return false;
-        }
-
-        // 填充响应数据
-        client->writeMsg.body_length(responseData.size());
-        std::memcpy(client->writeMsg.body(), responseData.data(), responseData.size());
-        client->writeMsg.encode_header();
-
-        // 发送数据
-        int totalSent = 0;
-        int dataLength = client->writeMsg.length();
-        const char* data = client->writeMsg.data();
-
-        while (totalSent < dataLength) {
-            int sent = send(client->clientSocket, data + totalSent, dataLength - totalSent, 0);
-            if (sent == SOCKET_ERROR) {
-                return false;
-            }
-            totalSent += sent;
-        }
-
-        return true;
-    }
-
     // 转化格式的合约列表
     static std::vector<std::string> LoadContracts1(std::unique_ptr<sql::ResultSet> res)
     {
@@ -328,19 +382,131 @@ public:
         }
     }
 
-    FuturesAlertServer() {
-        // 初始化路由映射
-        requestHandlers = {
-            {"register", &FuturesAlertServer::handleRegister},
-            {"login", &FuturesAlertServer::handleLogin},
-            {"set_email", &FuturesAlertServer::handleSetEmail},
-            // 预警相关（支持 price 与 time 两种 warning_type，通过字段区分）
-            {"add_warning", &FuturesAlertServer::handleAddWarning},
-            {"delete_warning", &FuturesAlertServer::handleDeleteWarning},
-            {"modify_warning", &FuturesAlertServer::handleModifyWarning},
-            {"query_warnings", &FuturesAlertServer::handleQueryWarnings},
-            {"alert_ack", &FuturesAlertServer::handleAlertAck}
-        };
+    // 热升级接管连接后恢复会话：为已登录的连接重新启动守护线程
+    static void resumeUserWatcher(const std::string& token, const std::string& username,
+        std::weak_ptr<ClientContext> client) {
+        if (token.empty()) return;
+        startUserWatcher(token, username, client);
+    }
+
+    FuturesAlertServer() = default;
+
+    // 按请求类型直接调用处理函数（请求类型在 request_types.h 中声明）。
+    // switch 不写 default，新增 RequestType 而漏掉分支时编译器会给出警告
+    json dispatch(RequestType type, const json& request) {
+        switch (type) {
+        case RequestType::Register:      return handleRegister(*this, request);
+        case RequestType::Login:         return handleLogin(*this, request);
+        case RequestType::SetEmail:      return handleSetEmail(*this, request);
+        // 预警相关（支持 price 与 time 两种 warning_type，通过字段区分）
+        case RequestType::AddWarning:    return handleAddWarning(*this, FromJson<AddWarningRequest>(request)).ToJson();
+        case RequestType::DeleteWarning: return handleDeleteWarning(*this, FromJson<DeleteWarningRequest>(request)).ToJson();
+        case RequestType::ModifyWarning: return handleModifyWarning(*this, FromJson<ModifyWarningRequest>(request)).ToJson();
+        case RequestType::QueryWarnings: return handleQueryWarnings(*this, request);
+        case RequestType::AlertAck:      return handleAlertAck(*this, FromJson<AlertAckRequest>(request)).ToJson();
+        case RequestType::Heartbeat:     return handleHeartbeat(*this, FromJson<HeartbeatRequest>(request)).ToJson();
+        case RequestType::Batch:         return handleBatch(*this, request);
+        case RequestType::Unknown:       break;
+        }
+        std::string reqType = request["type"];
+        std::string reqId = request.contains("request_id") ? request["request_id"] : "";
+        return createErrorResponse(reqId, reqType, "不支持的请求类型: " + reqType);
+    }
+
+    // 热点请求的类型化入口：请求体用 SAX 直接解析为请求结构体，不构造 JSON DOM；
+    // 响应结构固定，直接写入 frame（由 BeginFrame 开始的发送帧）。
+    // 返回 false 表示该类型没有类型化解析，调用方改走 routeRequest
+    bool routeTyped(RequestType type, const std::string& body, std::string& frame) {
+        SimpleResponse response;
+        switch (type) {
+        case RequestType::AddWarning:    response = parseAndHandle<AddWarningRequest>(body, "add_warning", &handleAddWarning); break;
+        case RequestType::DeleteWarning: response = parseAndHandle<DeleteWarningRequest>(body, "delete_warning", &handleDeleteWarning); break;
+        case RequestType::ModifyWarning: response = parseAndHandle<ModifyWarningRequest>(body, "modify_warning", &handleModifyWarning); break;
+        case RequestType::AlertAck:      response = parseAndHandle<AlertAckRequest>(body, "alert_ack", &handleAlertAck); break;
+        case RequestType::Heartbeat:     response = parseAndHandle<HeartbeatRequest>(body, "heartbeat", &handleHeartbeat); break;
+        default:                         return false;
+        }
+        JsonWriter writer(frame, responseEncoding());
+        response.Write(writer);
+        return true;
+    }
+
+    // 预警单的新增与修改交给组提交异步写入：处理线程不等待数据库，
+    // 写入完成后由执行器线程发出响应，再继续处理该连接有序通道中的后续请求（见 ResumeOrderedLane）。
+    // 返回 false 表示没有排队（非这两类请求、没有连接上下文或参数错误），调用方按同步方式处理并返回错误响应
+    bool routeDeferred(RequestType type, const std::string& body) {
+        ClientContext* client = ThreadLocalUser::GetClient();
+        if (client == NULL) return false;
+
+        try {
+            if (type == RequestType::AddWarning) {
+                AddWarningRequest request;
+                NewWarning w;
+                SimpleResponse error;
+                if (!ParseRequest(body, request) || !validateAddWarning(*this, request, w, error)) {
+                    return false;
+                }
+                WarningGroupCommit::Instance().Insert(w,
+                    [owner = client->shared_from_this(), reqId = request.requestId](bool failed, long long orderId) {
+                        completeDeferred(owner, failed
+                            ? SimpleResponse::Error(reqId, "add_warning", 1006, "添加预警单失败")
+                            : SimpleResponse::Success(reqId, "add_warning", "order_id", orderId));
+                    });
+                return true;
+            }
+            if (type == RequestType::ModifyWarning) {
+                ModifyWarningRequest request;
+                WarningChange change;
+                SimpleResponse error;
+                if (!ParseRequest(body, request) || !validateModifyWarning(request, change, error)) {
+                    return false;
+                }
+                WarningGroupCommit::Instance().Update(change,
+                    [owner = client->shared_from_this(), reqId = request.requestId](bool failed, long long) {
+                        completeDeferred(owner, failed
+                            ? SimpleResponse::Error(reqId, "modify_warning", 1006, "修改失败")
+                            : SimpleResponse::Success(reqId, "modify_warning"));
+                    });
+                return true;
+            }
+        }
+        catch (const std::exception&) {
+            // 交给同步路径生成错误响应
+        }
+        return false;
+    }
+
+    // 发出异步写入的响应并继续处理该连接的有序通道；连接已关闭时只继续（由处理线程清空 inbox）
+    static void completeDeferred(const std::shared_ptr<ClientContext>& client, const SimpleResponse& response) {
+        if (!client->closed) {
+            std::string frame;
+            BeginFrame(frame);
+            JsonWriter writer(frame, client->bodyEncoding);
+            response.Write(writer);
+            client->loop->SendFrame(client.get(), std::move(frame));
+        }
+        ResumeOrderedLane(client);
+    }
+
+    // 当前请求所属连接协商的响应编码，没有连接上下文时为 JSON
+    static int responseEncoding() {
+        ClientContext* client = ThreadLocalUser::GetClient();
+        return client != NULL ? client->bodyEncoding.load() : ChatMessage::body_json;
+    }
+
+    template <class Request>
+    SimpleResponse parseAndHandle(const std::string& body, const char* requestType,
+                                  SimpleResponse (*handler)(FuturesAlertServer&, const Request&)) {
+        Request request;
+        if (!ParseRequest(body, request)) {
+            return SimpleResponse::Error(request.requestId, requestType, 1002, "JSON解析错误");
+        }
+        try {
+            return handler(*this, request);
+        }
+        catch (const std::exception& e) {
+            return SimpleResponse::Error(request.requestId, requestType, 1001, "处理请求时发生错误: " + std::string(e.what()));
+        }
     }
 
     // 路由主函数：分发请求到对应的处理函数
@@ -351,34 +517,29 @@ public:
                 return createErrorResponse("", "", "缺少type字段");
             }
 
-            std::string reqType = requestData["type"];
-            std::string reqId = requestData.contains("request_id") ? requestData["request_id"] : "";
-
-            // 查找对应的处理函数
-            auto it = requestHandlers.find(reqType);
-            if (it == requestHandlers.end()) {
-                return createErrorResponse(reqId, reqType, "不支持的请求类型: " + reqType);
-            }
-
-            // 调用处理函数
-            return it->second(*this, requestData);
+            // 查找并调用对应的处理函数
+            const std::string& reqType = requestData["type"].get_ref<const std::string&>();
+            return dispatch(LookupRequestType(reqType), requestData);
         }
         catch (const std::exception& e) {
-            std::string reqId = requestData.contains("request_id") ? requestData["request_id"] : "";
-            std::string reqType = requestData.contains("type") ? requestData["type"] : "";
-            return createErrorResponse(reqId, reqType, "处理请求时发生错误: " + std::string(e.what()));
+            return createErrorResponse(stringField(requestData, "request_id"), stringField(requestData, "type"),
+                "处理请求时发生错误: " + std::string(e.what()));
         }
         catch (...) {
-            std::string reqId = requestData.contains("request_id") ? requestData["request_id"] : "";
-            std::string reqType = requestData.contains("type") ? requestData["type"] : "";
-            return createErrorResponse(reqId, reqType, "处理请求时发生未知错误");
+            return createErrorResponse(stringField(requestData, "request_id"), stringField(requestData, "type"),
+                "处理请求时发生未知错误");
         }
     }
 
-    // ---------------------- 数据库配置（可根据需要改） ----------------------
-    static sql::Connection* getConn() {
-        sql::Driver* driver = get_driver_instance();
-        return driver->connect("tcp://127.0.0.1:3306", "root", "123456");
+    // 读取字符串字段，不存在或类型不对时返回空（错误处理路径中使用，自身不抛异常）
+    static std::string stringField(const json& j, const char* key) {
+        auto it = j.find(key);
+        return (it != j.end() && it->is_string()) ? it->get<std::string>() : std::string();
+    }
+
+    // ---------------------- 数据库连接（从 DBManager 连接池借出，租约析构时归还） ----------------------
+    static ConnectionLease getConn() {
+        return DBManager::GetInstance()->Acquire();
     }
 
     // ---------------------- 注册 ----------------------
@@ -387,13 +548,11 @@ public:
         std::string username = request["username"];
         std::string password = request["password"];
 
+        ConnectionLease conn;
         try {
-            std::unique_ptr<sql::Connection> conn(getConn());
-            conn->setSchema("cpptestmysql");
+            conn = getConn();
 
-            std::unique_ptr<sql::PreparedStatement> stmt(
-                conn->prepareStatement("INSERT INTO user(account, password, state) VALUES(?, ?, 0)")
-            );
+            sql::PreparedStatement* stmt = conn.Prepare("INSERT INTO user(account, password, state) VALUES(?, ?, 0)");
             stmt->setString(1, username);
             stmt->setString(2, password);
             stmt->execute();
@@ -401,6 +560,7 @@ public:
             return server.createSuccessResponse(reqId, "register");
         }
         catch (sql::SQLException& e) {
+            conn.InvalidateOnConnectionError();
             // 用户名已存在 - 使用 error_code 2003
             return server.createErrorResponse(reqId, "register", 2003, "用户名已存在");
         }
@@ -412,13 +572,11 @@ public:
         std::string username = request["username"];
         std::string password = request["password"];
 
+        ConnectionLease conn;
         try {
-            std::unique_ptr<sql::Connection> conn(getConn());
-            conn->setSchema("cpptestmysql");
+            conn = getConn();
 
-            std::unique_ptr<sql::PreparedStatement> stmt(
-                conn->prepareStatement("SELECT userId FROM user WHERE account=? AND password=? AND state=0")
-            );
+            sql::PreparedStatement* stmt = conn.Prepare("SELECT userId FROM user WHERE account=? AND password=? AND state=0");
             stmt->setString(1, username);
             stmt->setString(2, password);
             std::unique_ptr<sql::ResultSet> res(stmt->executeQuery());
@@ -427,15 +585,38 @@ public:
                 std::string token = "token_" + username;
 
                 // 登录成功后启动与该用户关联的守护线程（生命周期由客户端连接控制）
-                startUserWatcher(token, username);
+                ClientContext* client = ThreadLocalUser::GetClient();
+                startUserWatcher(token, username,
+                    client ? client->weak_from_this() : std::weak_ptr<ClientContext>());
 				ThreadLocalUser::SetUserID(username);
 				ThreadLocalUser::SetUserToken(token);
-                return server.createSuccessResponse(reqId, "login");
+                if (client != NULL) {
+                    client->authenticated = true;
+                }
+
+                // 协商帧格式：客户端 ver >= 4.0 时改用 v4 二进制长度头（本条登录响应起生效）；
+                // ver >= 4.1 时消息体同时改用 MessagePack（只能由 v4 帧承载），否则保持 JSON；
+                // 请求带 "compression": "deflate" 时，之后超过阈值的帧压缩发送（标志位同样只有 v4 帧有）
+                json data = json::object();
+                double ver = std::atof(request.value("ver", "").c_str());
+                if (client != NULL && ver >= 4.0) {
+                    client->frameVersion = ChatMessage::frame_v4;
+                    data["frame_version"] = ChatMessage::frame_v4;
+                    data["max_frame_length"] = ChatMessage::max_frame_length();
+                    bool useMsgpack = ver >= 4.1;
+                    client->bodyEncoding = useMsgpack ? ChatMessage::body_msgpack : ChatMessage::body_json;
+                    data["body_encoding"] = useMsgpack ? "msgpack" : "json";
+                    bool useDeflate = request.value("compression", "") == "deflate";
+                    client->compressFrames = useDeflate;
+                    data["compression"] = useDeflate ? "deflate" : "none";
+                }
+                return server.createSuccessResponse(reqId, "login", data);
             }
             // 用户名或密码错误 - 使用 error_code 2002
             return server.createErrorResponse(reqId, "login", 2002, "用户名或密码错误");
         }
         catch (sql::SQLException& e) {
+            conn.InvalidateOnConnectionError();
             // 数据库错误 - 使用 error_code 1006
             return server.createErrorResponse(reqId, "login", 1006, e.what());
         }
@@ -447,13 +628,11 @@ public:
         std::string username = request["username"];
         std::string email = request["email"];
 
+        ConnectionLease conn;
         try {
-            std::unique_ptr<sql::Connection> conn(getConn());
-            conn->setSchema("cpptestmysql");
+            conn = getConn();
 
-            std::unique_ptr<sql::PreparedStatement> stmt(
-                conn->prepareStatement("UPDATE user SET email=? WHERE account=?")
-            );
+            sql::PreparedStatement* stmt = conn.Prepare("UPDATE user SET email=? WHERE account=?");
             stmt->setString(1, email);
             stmt->setString(2, username);
             stmt->execute();
@@ -461,239 +640,432 @@ public:
             return server.createSuccessResponse(reqId, "set_email");
         }
         catch (...) {
+            conn.InvalidateOnConnectionError();
             return server.createErrorResponse(reqId, "set_email", 1006, "设置邮箱失败");
         }
     }
 
     // ---------------------- 添加预警单 ----------------------
+    // 校验 add_warning 请求，失败时 error 为对应的错误响应
     // 支持两种 warning_type: "price" 和 "time"
-    static json handleAddWarning(FuturesAlertServer& server, const json& request) {
-        std::string reqId = request.contains("request_id") ? request["request_id"] : "";
-        std::string username = request.contains("account") ? request["account"] : (request.contains("username") ? request["username"] : "");
-        std::string symbol = request.contains("symbol") ? request["symbol"] : "";
-        std::string warningType = request.contains("warning_type") ? request["warning_type"] : "price";
-
-        if (username.empty() || symbol.empty()) {
-            return server.createErrorResponse(reqId, "add_warning", 1003, "缺少 account 或 symbol 字段");
+    static bool validateAddWarning(FuturesAlertServer& server, const AddWarningRequest& request, NewWarning& w, SimpleResponse& error) {
+        const std::string& reqId = request.requestId;
+        if (!request.badField.empty()) {
+            error = SimpleResponse::Error(reqId, "add_warning", 1003, "字段类型错误: " + request.badField);
+            return false;
         }
+        if (request.account.empty() || request.symbol.empty()) {
+            error = SimpleResponse::Error(reqId, "add_warning", 1003, "缺少 account 或 symbol 字段");
+            return false;
+        }
+        w.account = request.account;
+        w.symbol = request.symbol;
 
-        try {
-            std::unique_ptr<sql::Connection> conn(getConn());
-            conn->setSchema("cpptestmysql");
-
-            if (warningType == "price") {
-                if (!request.contains("max_price") || !request.contains("min_price")) {
-                    return server.createErrorResponse(reqId, "add_warning", 1003, "价格预警缺少 max_price 或 min_price");
-                }
-                double maxPrice = request["max_price"];
-                double minPrice = request["min_price"];
-
-                std::unique_ptr<sql::PreparedStatement> stmt(
-                    conn->prepareStatement(
-                        "INSERT INTO alert_order(account, symbol, max_price, min_price, trigger_time, state) "
-                        "VALUES (?, ?, ?, ?, NULL, 0)"
-                    )
-                );
-
-                stmt->setString(1, username);
-                stmt->setString(2, symbol);
-                stmt->setDouble(3, maxPrice);
-                stmt->setDouble(4, minPrice);
-                stmt->execute();
-            }
-            else if (warningType == "time") {
-                if (!request.contains("trigger_time")) {
-                    return server.createErrorResponse(reqId, "add_warning", 1003, "时间预警缺少 trigger_time");
-                }
-                std::string triggerTime = request["trigger_time"];
-
-                std::unique_ptr<sql::PreparedStatement> stmt(
-                    conn->prepareStatement(
-                        "INSERT INTO alert_order(account, symbol, max_price, min_price, trigger_time, state) "
-                        "VALUES (?, ?, NULL, NULL, ?, 0)"
-                    )
-                );
-
-                stmt->setString(1, username);
-                stmt->setString(2, symbol);
-                stmt->setString(3, triggerTime);
-                stmt->execute();
+        if (request.warningType == "price") {
+            if (!request.hasMaxPrice || !request.hasMinPrice) {
+                error = SimpleResponse::Error(reqId, "add_warning", 1003, "价格预警缺少 max_price 或 min_price");
+                return false;
             }
-            else {
-                return server.createErrorResponse(reqId, "add_warning", 1004, "未知的 warning_type: " + warningType);
+            w.isTime = false;
+            w.maxPrice = request.maxPrice;
+            w.minPrice = request.minPrice;
+        }
+        else if (request.warningType == "time") {
+            if (!request.hasTriggerTime) {
+                error = SimpleResponse::Error(reqId, "add_warning", 1003, "时间预警缺少 trigger_time");
+                return false;
             }
+            w.isTime = true;
+            w.triggerTime = request.triggerTime;
+        }
+        else {
+            error = SimpleResponse::Error(reqId, "add_warning", 1004, "未知的 warning_type: " + request.warningType);
+            return false;
+        }
+        return true;
+    }
 
-            // 获取刚插入的ID
-            std::unique_ptr<sql::PreparedStatement> stmt2(
-                conn->prepareStatement("SELECT LAST_INSERT_ID() AS id")
-            );
-            std::unique_ptr<sql::ResultSet> res(stmt2->executeQuery());
-            res->next();
-            long orderId = res->getInt("id");
+    static SimpleResponse handleAddWarning(FuturesAlertServer& server, const AddWarningRequest& request) {
+        const std::string& reqId = request.requestId;
 
-            return server.createSuccessResponse(reqId, "add_warning", {
-                {"order_id", orderId}
-                });
+        NewWarning w;
+        SimpleResponse error;
+        if (!validateAddWarning(server, request, w, error)) {
+            return error;
+        }
+
+        // 有序通道中的请求走 routeDeferred 的组提交，这里只处理没有连接上下文的调用
+        ConnectionLease conn;
+        try {
+            conn = getConn();
+            long long orderId = InsertWarning(conn, w);
+
+            return SimpleResponse::Success(reqId, "add_warning", "order_id", orderId);
         }
         catch (...) {
-            return server.createErrorResponse(reqId, "add_warning", 1006, "添加预警单失败");
+            conn.InvalidateOnConnectionError();
+            return SimpleResponse::Error(reqId, "add_warning", 1006, "添加预警单失败");
         }
     }
 
     // ---------------------- 删除预警单 ----------------------
-    static json handleDeleteWarning(FuturesAlertServer& server, const json& request) {
-        std::string reqId = request["request_id"];
-        long orderId = request["order_id"];
+    // 在给定连接上执行删除，数据库错误以异常抛出（单条请求与 batch 共用）
+    static SimpleResponse deleteWarning(FuturesAlertServer& server, const DeleteWarningRequest& request, ConnectionLease& conn) {
+        const std::string& reqId = request.requestId;
+        if (!request.badField.empty()) {
+            return SimpleResponse::Error(reqId, "delete_warning", 1003, "字段类型错误: " + request.badField);
+        }
+        if (!request.hasOrderId) {
+            return SimpleResponse::Error(reqId, "delete_warning", 1003, "缺少 order_id 字段");
+        }
 
-        try {
-            std::unique_ptr<sql::Connection> conn(getConn());
-            conn->setSchema("cpptestmysql");
+        sql::PreparedStatement* stmt = conn.Prepare("DELETE FROM alert_order WHERE orderId=?");
+        stmt->setInt64(1, request.orderId);
+        stmt->execute();
 
-            std::unique_ptr<sql::PreparedStatement> stmt(
-                conn->prepareStatement("DELETE FROM alert_order WHERE orderId=?")
-            );
-            stmt->setInt(1, orderId);
-            stmt->execute();
+        return SimpleResponse::Success(reqId, "delete_warning");
+    }
+
+    static SimpleResponse handleDeleteWarning(FuturesAlertServer& server, const DeleteWarningRequest& request) {
+        ConnectionLease conn;
+        try {
+            conn = getConn();
 
-            return server.createSuccessResponse(reqId, "delete_warning");
+            SimpleResponse response = deleteWarning(server, request, conn);
+            if (response.errorCode == 0) {
+                // 删除的行不会出现在预警缓存的增量重载中，直接从缓存移除
+                CMduserHandler::GetHandler().RemoveAlert(request.orderId);
+            }
+            return response;
         }
         catch (...) {
-            return server.createErrorResponse(reqId, "delete_warning", 3001, "删除失败");
+            conn.InvalidateOnConnectionError();
+            return SimpleResponse::Error(request.requestId, "delete_warning", 3001, "删除失败");
         }
     }
 
     // ---------------------- 修改预警单 ----------------------
-    // 支持修改 price 或 time 类型的字段（可选字段）
-    static json handleModifyWarning(FuturesAlertServer& server, const json& request) {
-        std::string reqId = request.contains("request_id") ? request["request_id"] : "";
-        long orderId = request["order_id"];
-        std::string warningType = request.contains("warning_type") ? request["warning_type"] : "price";
+    // 支持修改 price 或 time 类型的字段（可选字段）。
+    // 校验 modify_warning 请求，失败时 error 为对应的错误响应
+    static bool validateModifyWarning(const ModifyWarningRequest& request, WarningChange& change, SimpleResponse& error) {
+        const std::string& reqId = request.requestId;
+        if (!request.badField.empty()) {
+            error = SimpleResponse::Error(reqId, "modify_warning", 1003, "字段类型错误: " + request.badField);
+            return false;
+        }
+        if (!request.hasOrderId) {
+            error = SimpleResponse::Error(reqId, "modify_warning", 1003, "缺少 order_id 字段");
+            return false;
+        }
+        change.orderId = request.orderId;
 
+        if (request.warningType == "price") {
+            if (!request.hasMaxPrice && !request.hasMinPrice) {
+                error = SimpleResponse::Error(reqId, "modify_warning", 1003, "价格预警未提供可修改的字段");
+                return false;
+            }
+            change.hasMaxPrice = request.hasMaxPrice;
+            change.hasMinPrice = request.hasMinPrice;
+            change.maxPrice = request.maxPrice;
+            change.minPrice = request.minPrice;
+        }
+        else if (request.warningType == "time") {
+            if (!request.hasTriggerTime) {
+                error = SimpleResponse::Error(reqId, "modify_warning", 1003, "时间预警未提供 trigger_time");
+                return false;
+            }
+            change.hasTriggerTime = true;
+            change.triggerTime = request.triggerTime;
+        }
+        else {
+            error = SimpleResponse::Error(reqId, "modify_warning", 1004, "未知的 warning_type: " + request.warningType);
+            return false;
+        }
+        return true;
+    }
+
+    // 在给定连接上执行修改，数据库错误以异常抛出（batch 使用）
+    static SimpleResponse modifyWarning(FuturesAlertServer& server, const ModifyWarningRequest& request, ConnectionLease& conn) {
+        WarningChange change;
+        SimpleResponse error;
+        if (!validateModifyWarning(request, change, error)) {
+            return error;
+        }
+        UpdateWarnings(conn, { change });
+        return SimpleResponse::Success(request.requestId, "modify_warning");
+    }
+
+    static SimpleResponse handleModifyWarning(FuturesAlertServer& server, const ModifyWarningRequest& request) {
+        WarningChange change;
+        SimpleResponse error;
+        if (!validateModifyWarning(request, change, error)) {
+            return error;
+        }
+
+        // 有序通道中的请求走 routeDeferred 的组提交，这里只处理没有连接上下文的调用
+        ConnectionLease conn;
+        try {
+            conn = getConn();
+            UpdateWarnings(conn, { change });
+
+            return SimpleResponse::Success(request.requestId, "modify_warning");
+        }
+        catch (...) {
+            conn.InvalidateOnConnectionError();
+            return SimpleResponse::Error(request.requestId, "modify_warning", 1006, "修改失败");
+        }
+    }
+
+    // ---------------------- 批量请求 ----------------------
+    // 一帧携带多条预警单增删改请求：共用一个数据库连接、在一个事务中执行，最后返回一条汇总响应。
+    // add_warning 逐条 INSERT 并读取各自的 LAST_INSERT_ID（多行 INSERT 的自增 ID 不一定连续），整批只提交一次。
+    // 单条子请求的参数错误只影响该条；数据库错误时整批回滚。
+    static json handleBatch(FuturesAlertServer& server, const json& request) {
+        std::string reqId = stringField(request, "request_id");
+        if (request.contains("request_id") && !request["request_id"].is_string()) {
+            return server.createErrorResponse(reqId, "batch", 1003, "字段类型错误: request_id");
+        }
+        if (!request.contains("requests") || !request["requests"].is_array()) {
+            return server.createErrorResponse(reqId, "batch", 1003, "缺少 requests 数组");
+        }
+        const json& items = request["requests"];
+        if (items.empty() || items.size() > BATCH_MAX_REQUESTS) {
+            return server.createErrorResponse(reqId, "batch", 1003,
+                "子请求数量须在 1 到 " + std::to_string(BATCH_MAX_REQUESTS) + " 之间");
+        }
+
+        json results = json::array();
+        for (std::size_t i = 0; i < items.size(); ++i) {
+            results.push_back(nullptr);
+        }
+
+        ConnectionLease conn;
         try {
-            std::unique_ptr<sql::Connection> conn(getConn());
-            conn->setSchema("cpptestmysql");
+            conn = getConn();
+            conn->setAutoCommit(false);
 
-            if (warningType == "price") {
-                bool hasMax = request.contains("max_price");
-                bool hasMin = request.contains("min_price");
+            // 提交后需从预警缓存中移除的 orderId
+            std::vector<long long> deletedIds;
 
-                if (!hasMax && !hasMin) {
-                    return server.createErrorResponse(reqId, "modify_warning", 1003, "价格预警未提供可修改的字段");
+            for (std::size_t i = 0; i < items.size(); ++i) {
+                const json& item = items[i];
+                if (!item.is_object()) {
+                    results[i] = server.createErrorResponse("", "", 1003, "子请求必须是 JSON 对象");
+                    continue;
+                }
+                std::string itemType = stringField(item, "type");
+                std::string itemId = stringField(item, "request_id");
+                // 类型不对的 type / request_id 只让该条失败，不影响整批
+                const char* badField = nullptr;
+                if (item.contains("type") && !item["type"].is_string()) badField = "type";
+                else if (item.contains("request_id") && !item["request_id"].is_string()) badField = "request_id";
+                if (badField != nullptr) {
+                    results[i] = server.createErrorResponse(itemId, itemType, 1003, "字段类型错误: " + std::string(badField));
+                    continue;
                 }
 
-                if (hasMax && hasMin) {
-                    double maxPrice = request["max_price"];
-                    double minPrice = request["min_price"];
-                    std::unique_ptr<sql::PreparedStatement> stmt(
-                        conn->prepareStatement("UPDATE alert_order SET max_price=?, min_price=? WHERE orderId=?")
-                    );
-                    stmt->setDouble(1, maxPrice);
-                    stmt->setDouble(2, minPrice);
-                    stmt->setInt(3, orderId);
-                    stmt->execute();
+                if (itemType == "add_warning") {
+                    NewWarning w;
+                    SimpleResponse error;
+                    if (validateAddWarning(server, FromJson<AddWarningRequest>(item), w, error)) {
+                        results[i] = server.createSuccessResponse(itemId, "add_warning", {
+                            {"order_id", InsertWarning(conn, w)}
+                            });
+                    }
+                    else {
+                        results[i] = error.ToJson();
+                    }
+                    continue;
                 }
-                else if (hasMax) {
-                    double maxPrice = request["max_price"];
-                    std::unique_ptr<sql::PreparedStatement> stmt(
-                        conn->prepareStatement("UPDATE alert_order SET max_price=? WHERE orderId=?")
-                    );
-                    stmt->setDouble(1, maxPrice);
-                    stmt->setInt(2, orderId);
-                    stmt->execute();
+
+                if (itemType == "delete_warning") {
+                    DeleteWarningRequest deleteRequest = FromJson<DeleteWarningRequest>(item);
+                    SimpleResponse response = deleteWarning(server, deleteRequest, conn);
+                    if (response.errorCode == 0) {
+                        deletedIds.push_back(deleteRequest.orderId);
+                    }
+                    results[i] = response.ToJson();
                 }
-                else { // hasMin
-                    double minPrice = request["min_price"];
-                    std::unique_ptr<sql::PreparedStatement> stmt(
-                        conn->prepareStatement("UPDATE alert_order SET min_price=? WHERE orderId=?")
-                    );
-                    stmt->setDouble(1, minPrice);
-                    stmt->setInt(2, orderId);
-                    stmt->execute();
+                else if (itemType == "modify_warning") {
+                    results[i] = modifyWarning(server, FromJson<ModifyWarningRequest>(item), conn).ToJson();
                 }
-            }
-            else if (warningType == "time") {
-                if (!request.contains("trigger_time")) {
-                    return server.createErrorResponse(reqId, "modify_warning", 1003, "时间预警未提供 trigger_time");
+                else {
+                    results[i] = server.createErrorResponse(itemId, itemType, 1004, "batch 不支持的请求类型: " + itemType);
                 }
-                std::string triggerTime = request["trigger_time"];
-                std::unique_ptr<sql::PreparedStatement> stmt(
-                    conn->prepareStatement("UPDATE alert_order SET trigger_time=? WHERE orderId=?")
-                );
-                stmt->setString(1, triggerTime);
-                stmt->setInt(2, orderId);
-                stmt->execute();
             }
-            else {
-                return server.createErrorResponse(reqId, "modify_warning", 1004, "未知的 warning_type: " + warningType);
+            conn->commit();
+            for (long long orderId : deletedIds) {
+                CMduserHandler::GetHandler().RemoveAlert(orderId);
             }
-
-            return server.createSuccessResponse(reqId, "modify_warning");
         }
         catch (...) {
-            return server.createErrorResponse(reqId, "modify_warning", 1006, "修改失败");
+            conn.InvalidateOnConnectionError();
+            if (conn) {
+                try { conn->rollback(); }
+                catch (...) {}
+            }
+            return server.createErrorResponse(reqId, "batch", 1006, "批量执行失败，已全部回滚");
         }
+
+        // 子响应省略 type 字段，减小汇总响应体积
+        for (auto& r : results) {
+            r.erase("type");
+        }
+        return server.createSuccessResponse(reqId, "batch", {
+            {"results", results}
+            });
     }
 
     // ---------------------- 查询预警单 ----------------------
+    // 按 orderId 键集分页（orderId > 游标 ORDER BY orderId LIMIT n），status_filter 下推到 SQL。
+    // 每页是一条独立的响应帧：前面的页直接推送给客户端，最后一页作为返回值，
+    // 因此单次请求的内存与耗时不随用户的历史预警单数量增长。
+    // 需要 alert_order(account, orderId) 索引，否则每页仍会扫描该用户的全部记录。
     static json handleQueryWarnings(FuturesAlertServer& server, const json& request) {
 		static const string map1[3] = { "active", "triggered","all" };
-        std::string reqId = request["request_id"];
-        std::string username = request["username"];
+        std::string reqId = request.contains("request_id") ? request["request_id"] : "";
+        std::string username = request.contains("account") ? request["account"] : (request.contains("username") ? request["username"] : "");
+        std::string statusFilter = request.contains("status_filter") ? request["status_filter"] : "all";
 
-        try {
-            std::unique_ptr<sql::Connection> conn(getConn());
-            conn->setSchema("cpptestmysql");
-
-            std::unique_ptr<sql::PreparedStatement> stmt(
-                conn->prepareStatement(
-                    "SELECT orderId, symbol, max_price, min_price, trigger_time, state "
-                    "FROM alert_order WHERE account=?"
-                )
-            );
-            stmt->setString(1, username);
-            std::unique_ptr<sql::ResultSet> res(stmt->executeQuery());
+        if (username.empty()) {
+            return server.createErrorResponse(reqId, "query_warnings", 1003, "缺少 account 字段");
+        }
 
-            json arr = json::array();
-            while (res->next()) {
-                arr.push_back({
-                    {"order_id", res->getInt("orderId")},
-                    {"symbol", res->getString("symbol")},
-                    {"max_price", res->isNull("max_price") ? nullptr : json(res->getDouble("max_price"))},
-                    {"min_price", res->isNull("min_price") ? nullptr : json(res->getDouble("min_price"))},
-                    {"trigger_time", res->isNull("trigger_time") ? "" : res->getString("trigger_time")},
-                    {"state", map1[res->getInt("state")]}
-                    });
+        int stateFilter = -1;
+        if (statusFilter == "active") stateFilter = 0;
+        else if (statusFilter == "triggered") stateFilter = 1;
+        else if (statusFilter != "all") {
+            return server.createErrorResponse(reqId, "query_warnings", 1004, "未知的 status_filter: " + statusFilter);
+        }
+
+        // 可选：从指定游标之后继续查询（字符串或整数形式的 order_id）、指定每页条数
+        long long cursor = 0;
+        if (request.contains("cursor")) {
+            const json& value = request["cursor"];
+            bool valid = false;
+            if (value.is_string()) {
+                const std::string& text = value.get_ref<const std::string&>();
+                auto result = std::from_chars(text.data(), text.data() + text.size(), cursor);
+                valid = result.ec == std::errc() && result.ptr == text.data() + text.size();
+            }
+            else if (value.is_number_integer()) {
+                cursor = value.get<long long>();
+                valid = true;
             }
+            if (!valid || cursor < 0) {
+                return server.createErrorResponse(reqId, "query_warnings", 1003, "字段类型错误: cursor");
+            }
+        }
+        // v3 帧消息体上限 4KB，客户端指定的每页条数也不能超过 QUERY_PAGE_SIZE_V3，否则响应帧超长
+        ClientContext* client = ThreadLocalUser::GetClient();
+        bool v4 = client != NULL && client->frameVersion == ChatMessage::frame_v4;
+        int maxPageSize = v4 ? QUERY_MAX_PAGE_SIZE : QUERY_PAGE_SIZE_V3;
+        int pageSize = v4 ? QUERY_PAGE_SIZE : QUERY_PAGE_SIZE_V3;
+        if (request.contains("page_size")) {
+            const json& value = request["page_size"];
+            if (!value.is_number_integer()) {
+                return server.createErrorResponse(reqId, "query_warnings", 1003, "字段类型错误: page_size");
+            }
+            long long requested = value.get<long long>();
+            pageSize = static_cast<int>((std::max)(1LL, (std::min)(requested, static_cast<long long>(maxPageSize))));
+        }
+
+        ConnectionLease conn;
+        try {
+            conn = getConn();
+
+            std::string sql =
+                "SELECT orderId, symbol, max_price, min_price, trigger_time, state "
+                "FROM alert_order WHERE account=? AND orderId>?";
+            if (stateFilter >= 0) sql += " AND state=?";
+            sql += " ORDER BY orderId LIMIT ?";
+            sql::PreparedStatement* stmt = conn.Prepare(sql);
+
+            long long total = 0;
+            for (int page = 0; ; ++page) {
+                int idx = 1;
+                stmt->setString(idx++, username);
+                stmt->setInt64(idx++, cursor);
+                if (stateFilter >= 0) stmt->setInt(idx++, stateFilter);
+                // 多取一条用于判断是否还有下一页
+                stmt->setInt(idx++, pageSize + 1);
+                std::unique_ptr<sql::ResultSet> res(stmt->executeQuery());
+
+                json arr = json::array();
+                bool hasMore = false;
+                while (res->next()) {
+                    if (static_cast<int>(arr.size()) == pageSize) {
+                        hasMore = true;
+                        break;
+                    }
+                    cursor = res->getInt64("orderId");
+                    int state = res->getInt("state");
+                    bool isTime = res->isNull("max_price") && res->isNull("min_price") && !res->isNull("trigger_time");
+                    arr.push_back({
+                        {"order_id", std::to_string(cursor)},
+                        {"symbol", res->getString("symbol")},
+                        {"warning_type", isTime ? "time" : "price"},
+                        {"max_price", res->isNull("max_price") ? nullptr : json(res->getDouble("max_price"))},
+                        {"min_price", res->isNull("min_price") ? nullptr : json(res->getDouble("min_price"))},
+                        {"trigger_time", res->isNull("trigger_time") ? "" : res->getString("trigger_time")},
+                        {"state", map1[(state >= 0 && state < 3) ? state : 0]},
+                        {"status", map1[(state >= 0 && state < 3) ? state : 0]}
+                        });
+                }
+                total += arr.size();
+
+                json data = {
+                    {"warnings", arr},
+                    {"page", page},
+                    {"has_more", hasMore},
+                    {"next_cursor", std::to_string(cursor)}
+                };
+                if (!hasMore) {
+                    data["total"] = total;
+                }
+                json resp = server.createSuccessResponse(reqId, "query_warnings", data);
 
-            return server.createSuccessResponse(reqId, "query_warnings", {
-                {"warnings", arr}
-                });
+                // 最后一页，或没有客户端连接可推送（此时由调用方用 next_cursor 继续查询）
+                if (!hasMore || client == NULL) {
+                    return resp;
+                }
+                std::string frame;
+                BeginFrame(frame, 0);
+                AppendJson(frame, resp, client->bodyEncoding);
+                if (!client->loop->SendFrame(client, std::move(frame))) {
+                    // 客户端已断开，不再继续查询
+                    return resp;
+                }
+            }
         }
         catch (...) {
+            conn.InvalidateOnConnectionError();
             return server.createErrorResponse(reqId, "query_warnings", 1006, "查询失败");
         }
     }
 
     // ---------------------- 预警确认 ----------------------
-    static json handleAlertAck(FuturesAlertServer& server, const json& request) {
-        std::string reqId = request.contains("request_id") ? request["request_id"] : "";
-        long orderId = request["order_id"];
-
-        try {
-            std::unique_ptr<sql::Connection> conn(getConn());
-            conn->setSchema("cpptestmysql");
-
-            std::unique_ptr<sql::PreparedStatement> stmt(
-                conn->prepareStatement("UPDATE alert_order SET state=1 WHERE orderId=?")
-            );
-            stmt->setInt(1, orderId);
-            stmt->execute();
-
-            return server.createSuccessResponse(reqId, "alert_ack");
+    static SimpleResponse handleAlertAck(FuturesAlertServer& server, const AlertAckRequest& request) {
+        const std::string& reqId = request.requestId;
+        if (!request.badField.empty()) {
+            return SimpleResponse::Error(reqId, "alert_ack", 1003, "字段类型错误: " + request.badField);
         }
-        catch (...) {
-            return server.createErrorResponse(reqId, "alert_ack", 1006, "确认失败");
+        if (!request.hasOrderId) {
+            return SimpleResponse::Error(reqId, "alert_ack", 1003, "缺少 order_id 字段");
         }
+
+        // 状态更新放入回写队列后即回复，由执行器上的回写任务批量写入
+        AlertStateWriter::Instance().MarkTriggered(request.orderId);
+        return SimpleResponse::Success(reqId, "alert_ack");
+    }
+
+    // ---------------------- 心跳 ----------------------
+    // 连接的活跃时间由 I/O 线程在收到数据时更新，这里只回复服务器时间供客户端估算延迟
+    static SimpleResponse handleHeartbeat(FuturesAlertServer& server, const HeartbeatRequest& request) {
+        const std::string& reqId = request.requestId;
+        long long serverTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        return SimpleResponse::Success(reqId, "heartbeat", "server_time", serverTime);
     }
 
 };
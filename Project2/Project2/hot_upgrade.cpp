@@ -0,0 +1,484 @@
+﻿#include "hot_upgrade.h"
+#include "connection_pool.h"
+#include "threadpool.h"
+#include "alert_state_writer.h"
+#include <cstdint>
+#include <cstring>
+
+bool ParseHotUpgrade(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--hot-upgrade") == 0) return true;
+    }
+    return false;
+}
+
+bool ParseTakeover(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--takeover") == 0) return true;
+    }
+    return false;
+}
+
+namespace {
+
+// 交接格式变化时递增末位，新旧格式不兼容的进程之间拒绝交接
+const char HANDOFF_MAGIC[4] = { 'F', 'A', 'H', '4' };
+
+// 交接消息：4 字节总长度 + 消息体。新旧进程在同一台机器上，定长字段按本机字节序原样写入，
+// 变长字段前加 4 字节长度。
+// 消息体：魔数、监听 socket 的 WSAPROTOCOL_INFOW、连接数，每个连接依次为
+// WSAPROTOCOL_INFOW、对端地址、帧版本、消息体编码、是否压缩、用户 ID、token、未处理的接收数据、
+// 未发送的帧数，每帧为发送优先级（SendPriority）和帧数据
+class HandoffWriter {
+public:
+    void Raw(const void* p, std::size_t n) { buf.append(static_cast<const char*>(p), n); }
+    void U32(uint32_t v) { Raw(&v, sizeof(v)); }
+    void Str(const std::string& s) {
+        U32(static_cast<uint32_t>(s.size()));
+        Raw(s.data(), s.size());
+    }
+    std::string buf;
+};
+
+class HandoffReader {
+public:
+    explicit HandoffReader(const std::string& data) : data(data), pos(0) {}
+    bool Raw(void* p, std::size_t n) {
+        if (data.size() - pos < n) return false;
+        memcpy(p, data.data() + pos, n);
+        pos += n;
+        return true;
+    }
+    bool U32(uint32_t& v) { return Raw(&v, sizeof(v)); }
+    bool Str(std::string& s) {
+        uint32_t n = 0;
+        if (!U32(n) || data.size() - pos < n) return false;
+        s.assign(data, pos, n);
+        pos += n;
+        return true;
+    }
+private:
+    const std::string& data;
+    std::size_t pos;
+};
+
+bool ReadExact(HANDLE pipe, void* buf, DWORD n) {
+    char* p = static_cast<char*>(buf);
+    while (n > 0) {
+        DWORD got = 0;
+        if (!ReadFile(pipe, p, n, &got, NULL) || got == 0) return false;
+        p += got;
+        n -= got;
+    }
+    return true;
+}
+
+bool WriteExact(HANDLE pipe, const void* buf, DWORD n) {
+    const char* p = static_cast<const char*>(buf);
+    while (n > 0) {
+        DWORD written = 0;
+        if (!WriteFile(pipe, p, n, &written, NULL) || written == 0) return false;
+        p += written;
+        n -= written;
+    }
+    return true;
+}
+
+std::string PipeName(unsigned short port) {
+    return std::string(HOT_UPGRADE_PIPE_PREFIX) + std::to_string(port);
+}
+
+// 等待交接的连接上排队和执行中的请求处理完，保证它们的响应都已进入发送队列。
+// 有序通道在 inbox 非空或请求等待批量写入时保持 scheduled，一并在此等待。
+// 返回 false 表示超时仍有连接未处理完
+bool WaitForHandlers(const std::vector<std::shared_ptr<ClientContext>>& clients) {
+    ULONGLONG deadline = GetTickCount64() + HOT_UPGRADE_DRAIN_TIMEOUT_MS;
+    for (auto& client : clients) {
+        for (;;) {
+            bool busy;
+            {
+                std::lock_guard<std::mutex> lk(client->inboxMutex);
+                busy = client->scheduled || !client->inbox.empty() || client->parallelInflight > 0;
+            }
+            if (!busy) break;
+            if (GetTickCount64() >= deadline) return false;
+            Sleep(10);
+        }
+    }
+    return true;
+}
+
+// 已交出（或尝试交出）的连接在交接确认前保留的状态，交接失败时据此恢复
+struct DetachedClient {
+    std::shared_ptr<ClientContext> client;
+    bool handedOff = false;             // 已写入交接消息：发送队列、接收数据已取出，守护线程已停止
+    std::string pendingInput;
+    std::vector<std::string> pendingOutput;
+    std::vector<SendPriority> priorities;
+    std::string userId;
+    std::string userToken;
+};
+
+// 交接失败：重新启动 reactor 接入新连接，把取出的连接连同其状态放回。
+// 返回 false 表示 reactor 无法重新启动，连接未恢复
+bool RestoreConnections(Reactor& reactor, SOCKET listenSocket, std::vector<DetachedClient>& detached) {
+    if (!reactor.Start() || !reactor.StartAccepting(listenSocket)) {
+        return false;
+    }
+    for (auto& d : detached) {
+        auto& client = d.client;
+        {
+            std::lock_guard<std::mutex> lk(client->sendMutex);
+            for (std::size_t i = 0; i < d.pendingOutput.size(); ++i) {
+                client->outbound.Push(std::move(d.pendingOutput[i]), d.priorities[i]);
+            }
+            client->wantWrite = !client->outbound.Empty();
+            client->closed = false;
+        }
+        if (d.handedOff) {
+            client->decoder.Append(d.pendingInput.data(), d.pendingInput.size());
+        }
+        // 交出时 I/O 线程已停止，尚未执行的恢复读取请求随之丢弃
+        client->resumePosted = false;
+        if (!reactor.AdoptConnection(client)) {
+            client->closed = true;
+            continue;
+        }
+        if (d.handedOff) {
+            FuturesAlertServer::resumeUserWatcher(d.userToken, d.userId, client);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// ==========================================
+// 旧进程：等待接管并交出连接
+// ==========================================
+
+HotUpgradeListener::HotUpgradeListener()
+    : hPipe(INVALID_HANDLE_VALUE), targetPid(0), requested(false), stopping(false), finished(true) {
+}
+
+HotUpgradeListener::~HotUpgradeListener() {
+    Stop();
+}
+
+bool HotUpgradeListener::Start(unsigned short port) {
+    if (waitThread.joinable()) return true;
+    pipeName = PipeName(port);
+    stopping = false;
+    finished = false;
+    waitThread = std::thread([this]() { Run(); });
+    std::cout << "[热升级已启用] 管道: " << pipeName << std::endl;
+    return true;
+}
+
+void HotUpgradeListener::Stop() {
+    stopping = true;
+    // 线程可能阻塞在 ConnectNamedPipe 上，连接一次管道使其返回
+    while (waitThread.joinable() && !finished) {
+        HANDLE h = CreateFileA(pipeName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+        if (h != INVALID_HANDLE_VALUE) {
+            CloseHandle(h);
+        }
+        Sleep(10);
+    }
+    if (waitThread.joinable()) {
+        waitThread.join();
+    }
+    if (hPipe != INVALID_HANDLE_VALUE) {
+        CloseHandle(hPipe);
+        hPipe = INVALID_HANDLE_VALUE;
+    }
+}
+
+void HotUpgradeListener::Run() {
+    bool reported = false;
+    while (!stopping) {
+        HANDLE pipe = CreateNamedPipeA(pipeName.c_str(), PIPE_ACCESS_DUPLEX,
+            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+            1, 64 * 1024, 64 * 1024, 0, NULL);
+        if (pipe == INVALID_HANDLE_VALUE) {
+            // 刚接管时旧进程可能还未关闭同名管道，稍后重试
+            if (!reported) {
+                std::cerr << "[热升级管道创建失败] 错误码: " << GetLastError() << std::endl;
+                reported = true;
+            }
+            Sleep(100);
+            continue;
+        }
+
+        BOOL connected = ConnectNamedPipe(pipe, NULL) ? TRUE : (GetLastError() == ERROR_PIPE_CONNECTED);
+        DWORD pid = 0;
+        if (stopping || !connected || !ReadExact(pipe, &pid, sizeof(pid))) {
+            CloseHandle(pipe);
+            continue;
+        }
+
+        // 交接由主线程执行
+        hPipe = pipe;
+        targetPid = pid;
+        requested = true;
+        break;
+    }
+    finished = true;
+}
+
+bool HotUpgradeListener::Handoff(Reactor& reactor, SOCKET& listenSocket) {
+    requested = false;
+    HANDLE pipe = hPipe;
+    hPipe = INVALID_HANDLE_VALUE;
+    std::cout << "[热升级] 新进程请求接管, PID: " << targetPid << std::endl;
+
+    // 先复制监听 socket：失败或后端不支持时拒绝交接，本进程照常服务
+    WSAPROTOCOL_INFOW info;
+    std::vector<std::shared_ptr<ClientContext>> clients;
+    bool accepted = false;
+    if (reactor.Backend() != IoBackend::Poll) {
+        std::cerr << "[热升级失败] 当前网络后端不支持交接连接（需 --io=poll）" << std::endl;
+    }
+    else if (WSADuplicateSocketW(listenSocket, targetPid, &info) != 0) {
+        std::cerr << "[复制监听Socket失败] 错误码: " << WSAGetLastError() << std::endl;
+    }
+    else {
+        // 预警判断交给新进程：先停止本进程的判断并写完已触发的状态，
+        // 新进程接管后才启动行情服务，从数据库加载的缓存不含这些单子，两边不会重复触发
+        CMduserHandler::GetHandler().SetAlertsPaused(true);
+        if (!AlertStateWriter::Instance().FlushNow()) {
+            std::cerr << "[热升级失败] 预警状态无法写入数据库，拒绝交接" << std::endl;
+        }
+        else {
+            accepted = reactor.DetachAll(clients);
+        }
+    }
+    if (!accepted) {
+        CMduserHandler::GetHandler().SetAlertsPaused(false);
+        uint32_t refused = 0;
+        WriteExact(pipe, &refused, sizeof(refused));
+        CloseHandle(pipe);
+
+        // 继续服务并等待下一次接管请求
+        Rearm();
+        return false;
+    }
+
+    // 不再读取新请求，等已收到的请求处理完。超时仍未处理完的请求无法随交接消息转交，
+    // 拒绝交接并原样恢复连接，避免这些请求随本进程退出而丢失
+    bool drained = WaitForHandlers(clients);
+    if (!drained) {
+        std::cerr << "[热升级失败] 连接上的请求未在 " << HOT_UPGRADE_DRAIN_TIMEOUT_MS << "ms 内处理完，拒绝交接" << std::endl;
+    }
+
+    HandoffWriter msg;
+    msg.Raw(HANDOFF_MAGIC, sizeof(HANDOFF_MAGIC));
+    msg.Raw(&info, sizeof(info));
+
+    HandoffWriter records;
+    uint32_t count = 0;
+    std::vector<DetachedClient> detached;
+    detached.reserve(clients.size());
+    for (auto& client : clients) {
+        DetachedClient d;
+        d.client = client;
+        if (!drained) {
+            detached.push_back(std::move(d));
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lk(client->sendMutex);
+            if (client->closed) continue;
+            if (WSADuplicateSocketW(client->clientSocket, targetPid, &info) != 0) {
+                std::cerr << "[复制客户端Socket失败] 错误码: " << WSAGetLastError() << std::endl;
+                detached.push_back(std::move(d));
+                continue;
+            }
+            // 此后的告警推送不再进入本进程的发送队列
+            client->closed = true;
+            client->outbound.TakeAll(d.pendingOutput, d.priorities);
+        }
+
+        {
+            std::lock_guard<std::mutex> lk(client->sessionMutex);
+            d.userId = client->userId;
+            d.userToken = client->userToken;
+        }
+        FuturesAlertServer::stopUserWatcher(d.userToken);
+
+        client->decoder.TakeBuffered(d.pendingInput);
+        d.handedOff = true;
+
+        records.Raw(&info, sizeof(info));
+        records.Raw(&client->clientAddr, sizeof(client->clientAddr));
+        records.U32(static_cast<uint32_t>(client->frameVersion.load()));
+        records.U32(static_cast<uint32_t>(client->bodyEncoding.load()));
+        records.U32(client->compressFrames ? 1u : 0u);
+        records.Str(d.userId);
+        records.Str(d.userToken);
+        records.Str(d.pendingInput);
+        records.U32(static_cast<uint32_t>(d.pendingOutput.size()));
+        for (std::size_t i = 0; i < d.pendingOutput.size(); ++i) {
+            records.U32(static_cast<uint32_t>(d.priorities[i]));
+            records.Str(d.pendingOutput[i]);
+        }
+        detached.push_back(std::move(d));
+        count++;
+    }
+    msg.U32(count);
+    msg.Raw(records.buf.data(), records.buf.size());
+
+    bool transferred = false;
+    if (drained) {
+        uint32_t total = static_cast<uint32_t>(msg.buf.size());
+        char ack = 0;
+        transferred = WriteExact(pipe, &total, sizeof(total))
+            && WriteExact(pipe, msg.buf.data(), total)
+            && ReadExact(pipe, &ack, sizeof(ack))
+            && ack == 1;
+    }
+    else {
+        uint32_t refused = 0;
+        WriteExact(pipe, &refused, sizeof(refused));
+    }
+    CloseHandle(pipe);
+
+    if (!transferred) {
+        // 拒绝交接或新进程未确认（它已关闭收到的句柄）：本进程恢复连接与监听，继续服务并等待下一次接管请求
+        if (RestoreConnections(reactor, listenSocket, detached)) {
+            for (auto& client : clients) {
+                if (client->closed) closesocket(client->clientSocket);
+            }
+            CMduserHandler::GetHandler().SetAlertsPaused(false);
+            std::cerr << "[热升级失败] 交接未完成，已恢复连接数: " << detached.size() << std::endl;
+            Rearm();
+            return false;
+        }
+        std::cerr << "[热升级失败] 交接未完成，I/O 线程无法重新启动，连接已关闭" << std::endl;
+    }
+
+    // 关闭本进程的句柄：交接成功时 socket 由新进程的句柄保持打开
+    for (auto& client : clients) {
+        client->closed = true;
+        closesocket(client->clientSocket);
+    }
+    if (transferred) {
+        closesocket(listenSocket);
+        listenSocket = INVALID_SOCKET;
+        std::cout << "[热升级完成] 已交接连接数: " << count << std::endl;
+    }
+    return true;
+}
+
+void HotUpgradeListener::Rearm() {
+    if (waitThread.joinable()) waitThread.join();
+    finished = false;
+    waitThread = std::thread([this]() { Run(); });
+}
+
+// ==========================================
+// 新进程：接管监听 socket 与客户端连接
+// ==========================================
+
+bool TakeOverFromRunningServer(unsigned short port, SOCKET& listenSocket,
+    std::vector<std::shared_ptr<ClientContext>>& connections) {
+    std::string name = PipeName(port);
+    if (!WaitNamedPipeA(name.c_str(), HOT_UPGRADE_CONNECT_TIMEOUT_MS)) {
+        std::cerr << "[热升级失败] 未找到可接管的服务器进程, 错误码: " << GetLastError() << std::endl;
+        return false;
+    }
+    HANDLE pipe = CreateFileA(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    if (pipe == INVALID_HANDLE_VALUE) {
+        std::cerr << "[热升级管道连接失败] 错误码: " << GetLastError() << std::endl;
+        return false;
+    }
+
+    DWORD pid = GetCurrentProcessId();
+    uint32_t total = 0;
+    if (!WriteExact(pipe, &pid, sizeof(pid)) || !ReadExact(pipe, &total, sizeof(total)) || total == 0) {
+        std::cerr << "[热升级失败] 旧进程拒绝交接" << std::endl;
+        CloseHandle(pipe);
+        return false;
+    }
+    std::string payload(total, '\0');
+    if (!ReadExact(pipe, &payload[0], total)) {
+        std::cerr << "[热升级失败] 交接数据不完整" << std::endl;
+        CloseHandle(pipe);
+        return false;
+    }
+
+    HandoffReader reader(payload);
+    char magic[sizeof(HANDOFF_MAGIC)];
+    WSAPROTOCOL_INFOW info;
+    uint32_t count = 0;
+    bool ok = reader.Raw(magic, sizeof(magic)) && memcmp(magic, HANDOFF_MAGIC, sizeof(magic)) == 0
+        && reader.Raw(&info, sizeof(info));
+    if (ok) {
+        listenSocket = WSASocketW(FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO, &info, 0, 0);
+        u_long mode = 1;
+        ok = listenSocket != INVALID_SOCKET && ioctlsocket(listenSocket, FIONBIO, &mode) != SOCKET_ERROR;
+    }
+    ok = ok && reader.U32(count);
+
+    for (uint32_t i = 0; ok && i < count; ++i) {
+        sockaddr_in addr;
+        uint32_t frameVersion = 0, bodyEncoding = 0, compressFrames = 0, frames = 0;
+        std::string userId, userToken, pendingInput;
+        ok = reader.Raw(&info, sizeof(info)) && reader.Raw(&addr, sizeof(addr)) && reader.U32(frameVersion)
+            && reader.U32(bodyEncoding) && reader.U32(compressFrames) && reader.Str(userId) && reader.Str(userToken) && reader.Str(pendingInput) && reader.U32(frames);
+        if (!ok) break;
+
+        std::vector<std::string> pendingOutput(frames);
+        std::vector<SendPriority> priorities(frames);
+        for (uint32_t f = 0; ok && f < frames; ++f) {
+            uint32_t priority = 0;
+            ok = reader.U32(priority) && priority < SEND_PRIORITY_COUNT && reader.Str(pendingOutput[f]);
+            priorities[f] = static_cast<SendPriority>(priority);
+        }
+        if (!ok) break;
+
+        SOCKET s = WSASocketW(FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO, &info, 0, 0);
+        u_long mode = 1;
+        if (s == INVALID_SOCKET || ioctlsocket(s, FIONBIO, &mode) == SOCKET_ERROR) {
+            std::cerr << "[接管客户端Socket失败] 错误码: " << WSAGetLastError() << std::endl;
+            if (s != INVALID_SOCKET) closesocket(s);
+            continue;
+        }
+
+        // 恢复会话状态、未处理的接收数据和未发出的帧
+        auto client = MakePooled<ClientContext>(s, addr);
+        client->frameVersion = static_cast<int>(frameVersion);
+        client->bodyEncoding = static_cast<int>(bodyEncoding);
+        client->compressFrames = compressFrames != 0;
+        client->userId = userId;
+        client->authenticated = !userId.empty();
+        client->userToken = userToken;
+        client->decoder.Append(pendingInput.data(), pendingInput.size());
+        // 按原优先级入队：告警推送在新进程中仍先于排队中的大块响应发出
+        for (uint32_t f = 0; f < frames; ++f) {
+            client->outbound.Push(std::move(pendingOutput[f]), priorities[f]);
+        }
+        client->wantWrite = !client->outbound.Empty();
+        connections.push_back(client);
+    }
+
+    char ack = ok ? 1 : 0;
+    WriteExact(pipe, &ack, sizeof(ack));
+    CloseHandle(pipe);
+
+    if (!ok) {
+        std::cerr << "[热升级失败] 交接数据格式错误" << std::endl;
+        for (auto& client : connections) {
+            closesocket(client->clientSocket);
+        }
+        connections.clear();
+        if (listenSocket != INVALID_SOCKET) {
+            closesocket(listenSocket);
+            listenSocket = INVALID_SOCKET;
+        }
+        return false;
+    }
+
+    std::cout << "[热升级] 已接管连接数: " << connections.size() << std::endl;
+    return true;
+}
@@ -0,0 +1,62 @@
+﻿#pragma once
+#ifndef HOT_UPGRADE_H
+#define HOT_UPGRADE_H
+
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <windows.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "reactor.h"
+
+// 热升级配置
+const char* const HOT_UPGRADE_PIPE_PREFIX = "\\\\.\\pipe\\FuturesAlertServer-";    // 交接用命名管道，后接监听端口
+const DWORD HOT_UPGRADE_CONNECT_TIMEOUT_MS = 5000;  // 新进程等待旧进程管道的最长时间
+const DWORD HOT_UPGRADE_DRAIN_TIMEOUT_MS = 5000;    // 旧进程等待处理中的请求完成的最长时间，超时则拒绝交接
+
+// 命令行：旧进程 --hot-upgrade 允许被接管；新进程 --takeover 从正在运行的旧进程接管
+bool ParseHotUpgrade(int argc, char* argv[]);
+bool ParseTakeover(int argc, char* argv[]);
+
+// 旧进程：在命名管道上等待新进程，收到接管请求后由主线程调用 Handoff 交出
+// 监听 socket 和所有客户端连接（socket 用 WSADuplicateSocket 复制给新进程，
+// 连同用户 ID、token、帧版本、未发出的推送和未处理完的接收数据），之后旧进程退出。
+// 交接期间客户端连接保持不断，新进程无需客户端重新登录和查询。
+// 仅支持 poll 后端：完成端口后端的 socket 已绑定到本进程的完成端口。
+class HotUpgradeListener {
+public:
+    HotUpgradeListener();
+    ~HotUpgradeListener();
+
+    bool Start(unsigned short port);
+    void Stop();
+
+    // 是否有新进程请求接管
+    bool Requested() const { return requested; }
+
+    // 交出监听 socket 和 reactor 中的连接，成功后 listenSocket 置为 INVALID_SOCKET。
+    // 返回 true 表示 reactor 已停止（连接已交出，或交接失败且 I/O 线程无法重新启动），旧进程应退出；
+    // 返回 false 表示未交接（当前后端不支持，或新进程未确认接管、连接与监听已恢复），继续服务并等待下一次请求
+    bool Handoff(Reactor& reactor, SOCKET& listenSocket);
+
+private:
+    void Run();
+    void Rearm();   // 重新启动等待线程
+
+    std::string pipeName;
+    std::thread waitThread;
+    HANDLE hPipe;
+    DWORD targetPid;
+    std::atomic<bool> requested;
+    std::atomic<bool> stopping;
+    std::atomic<bool> finished;     // 等待线程已退出
+};
+
+// 新进程：从旧进程接管监听 socket 与客户端连接，连接的会话状态已恢复，
+// 调用方再交给 Reactor::AdoptConnection
+bool TakeOverFromRunningServer(unsigned short port, SOCKET& listenSocket,
+    std::vector<std::shared_ptr<ClientContext>>& connections);
+
+#endif // HOT_UPGRADE_H
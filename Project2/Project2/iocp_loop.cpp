@@ -0,0 +1,407 @@
+﻿#include "iocp_loop.h"
+#include "connection_pool.h"
+#include "threadpool.h"
+
+IocpLoop::IocpLoop(ThreadPool* handlerPool, Reactor* reactor)
+    : EventLoop(handlerPool, reactor), completionPort(NULL), isRunning(false),
+      pendingOps(0), listenSocket(INVALID_SOCKET) {
+}
+
+IocpLoop::~IocpLoop() {
+    Stop();
+}
+
+bool IocpLoop::Start() {
+    if (isRunning) return true;
+
+    completionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+    if (completionPort == NULL) {
+        std::cerr << "[完成端口创建失败] 错误码: " << GetLastError() << std::endl;
+        return false;
+    }
+
+    isRunning = true;
+    ioThread = std::thread([this]() { Run(); });
+    return true;
+}
+
+void IocpLoop::Stop() {
+    if (!isRunning.exchange(false)) return;
+
+    // 空 OVERLAPPED 的完成包作为停止信号，由 I/O 线程关闭所有 socket 并等待未完成操作返回
+    PostQueuedCompletionStatus(completionPort, 0, 0, NULL);
+    if (ioThread.joinable()) {
+        ioThread.join();
+    }
+
+    CloseHandle(completionPort);
+    completionPort = NULL;
+    acceptOps.clear();
+}
+
+bool IocpLoop::StartAccepting(SOCKET listen) {
+    listenSocket = listen;
+    if (CreateIoCompletionPort(reinterpret_cast<HANDLE>(listenSocket), completionPort, 0, 0) == NULL) {
+        std::cerr << "[监听Socket绑定完成端口失败] 错误码: " << GetLastError() << std::endl;
+        return false;
+    }
+
+    // 监听 socket 只在本分片上投递 AcceptEx，按分片数放大预投递数量以承受重连高峰
+    int acceptCount = IOCP_ACCEPT_BACKLOG * static_cast<int>(reactor->LoopCount());
+    for (int i = 0; i < acceptCount; ++i) {
+        auto op = std::make_unique<IocpAcceptOp>();
+        op->type = IocpOpType::Accept;
+        op->acceptSocket = INVALID_SOCKET;
+        if (!PostAccept(op.get())) {
+            return false;
+        }
+        acceptOps.push_back(std::move(op));
+    }
+
+    std::cout << "[AcceptEx已投递] 数量: " << acceptCount << std::endl;
+    return true;
+}
+
+void IocpLoop::AddConnection(SOCKET clientSocket, const sockaddr_in& clientAddr) {
+    auto client = MakePooled<IocpClient>(clientSocket, clientAddr);
+    client->loop = this;
+
+    if (CreateIoCompletionPort(reinterpret_cast<HANDLE>(clientSocket), completionPort, 0, 0) == NULL) {
+        std::cerr << "[客户端Socket绑定完成端口失败] 错误码: " << GetLastError() << std::endl;
+        closesocket(clientSocket);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(connMutex);
+        connections[client.get()] = client;
+        if (idleWheel.Enabled()) {
+            newConnections.push_back(client);
+        }
+    }
+    connCount++;
+
+    char clientIP[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &(clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
+    std::cout << "[客户端连接] IP: " << clientIP << ", 端口: " << ntohs(clientAddr.sin_port) << std::endl;
+
+    if (!PostRecv(client)) {
+        HandleSocketError(client.get(), SOCKET_ERROR);
+        CloseConnection(client);
+    }
+}
+
+// 发送响应：帧进入发送队列，没有进行中的 WSASend 时立即投递
+bool IocpLoop::SendFrame(ClientContext* client, std::string&& frame, SendPriority priority) {
+    if (!FinishFrame(client, frame)) return false;
+
+    IocpClient* iocpClient = static_cast<IocpClient*>(client);
+    std::lock_guard<std::mutex> lk(client->sendMutex);
+    if (client->closed) return false;
+
+    if (!EnqueueFrame(client, std::move(frame), priority)) {
+        // 慢消费者：取消未完成的重叠操作，WSARecv 以失败返回后由 I/O 线程断开连接
+        if (client->sendOverflow) {
+            CancelIoEx(reinterpret_cast<HANDLE>(client->clientSocket), NULL);
+        }
+        return false;
+    }
+    if (!iocpClient->sendInFlight) {
+        return PostSend(iocpClient);
+    }
+    return true;
+}
+
+void IocpLoop::Run() {
+    OVERLAPPED_ENTRY entries[IOCP_BATCH_SIZE];
+    bool stopping = false;
+
+    while (!stopping || pendingOps > 0) {
+        ULONG count = 0;
+        // 启用空闲检测时最多等到时间轮下一格
+        DWORD waitMs = stopping ? IOCP_DRAIN_TIMEOUT_MS : idleWheel.NextTimeoutMs(GetTickCount64());
+        BOOL ok = GetQueuedCompletionStatusEx(completionPort, entries, IOCP_BATCH_SIZE, &count, waitMs, FALSE);
+        ioCalls++;
+        if (!ok) {
+            DWORD err = GetLastError();
+            if (err == WAIT_TIMEOUT && !stopping) {
+                ApplyNewConnections();
+                CheckIdleConnections();
+                continue;
+            }
+            if (!stopping) {
+                std::cerr << "[GetQueuedCompletionStatusEx失败] 错误码: " << err << std::endl;
+            }
+            break;
+        }
+
+        for (ULONG i = 0; i < count; ++i) {
+            if (entries[i].lpOverlapped == NULL) {
+                if (!stopping) {
+                    stopping = true;
+                    CloseAll();
+                }
+                continue;
+            }
+
+            IocpOp* op = reinterpret_cast<IocpOp*>(entries[i].lpOverlapped);
+            DWORD bytes = entries[i].dwNumberOfBytesTransferred;
+            pendingOps--;
+
+            if (op->type == IocpOpType::Resume) {
+                OnResume(static_cast<IocpIoOp*>(op));
+                continue;
+            }
+
+            if (op->type == IocpOpType::Accept) {
+                IocpAcceptOp* acceptOp = static_cast<IocpAcceptOp*>(op);
+                DWORD flags = 0;
+                bool success = WSAGetOverlappedResult(listenSocket, &op->ov, &bytes, FALSE, &flags) != FALSE;
+                OnAcceptComplete(acceptOp, success && !stopping);
+            }
+            else {
+                IocpIoOp* ioOp = static_cast<IocpIoOp*>(op);
+                DWORD flags = 0;
+                bool success = WSAGetOverlappedResult(ioOp->client->clientSocket, &op->ov, &bytes, FALSE, &flags) != FALSE;
+                if (op->type == IocpOpType::Recv) {
+                    OnRecvComplete(ioOp, bytes, success);
+                }
+                else {
+                    OnSendComplete(ioOp, bytes, success);
+                }
+            }
+        }
+
+        if (!stopping) {
+            ApplyNewConnections();
+            CheckIdleConnections();
+        }
+    }
+}
+
+// 把新接入的连接加入本分片的空闲时间轮
+void IocpLoop::ApplyNewConnections() {
+    std::vector<std::shared_ptr<ClientContext>> added;
+    {
+        std::lock_guard<std::mutex> lk(connMutex);
+        if (newConnections.empty()) return;
+        added.swap(newConnections);
+    }
+    ULONGLONG now = GetTickCount64();
+    for (auto& client : added) {
+        idleWheel.Add(client, now);
+    }
+}
+
+bool IocpLoop::PostAccept(IocpAcceptOp* op) {
+    op->acceptSocket = WSASocketW(AF_INET, SOCK_STREAM, IPPROTO_TCP, NULL, 0, WSA_FLAG_OVERLAPPED);
+    if (op->acceptSocket == INVALID_SOCKET) {
+        std::cerr << "[Socket创建失败] 错误码: " << WSAGetLastError() << std::endl;
+        return false;
+    }
+
+    memset(&op->ov, 0, sizeof(op->ov));
+    DWORD bytes = 0;
+    pendingOps++;
+    ioCalls++;
+    if (!AcceptEx(listenSocket, op->acceptSocket, op->addrBuffer, 0,
+        sizeof(sockaddr_in) + 16, sizeof(sockaddr_in) + 16, &bytes, &op->ov)
+        && WSAGetLastError() != ERROR_IO_PENDING) {
+        std::cerr << "[AcceptEx失败] 错误码: " << WSAGetLastError() << std::endl;
+        pendingOps--;
+        closesocket(op->acceptSocket);
+        op->acceptSocket = INVALID_SOCKET;
+        return false;
+    }
+    return true;
+}
+
+void IocpLoop::OnAcceptComplete(IocpAcceptOp* op, bool ok) {
+    SOCKET clientSocket = op->acceptSocket;
+    op->acceptSocket = INVALID_SOCKET;
+
+    if (!ok) {
+        closesocket(clientSocket);
+        // 单个连接在 accept 前被对端重置属于正常情况，继续补投
+        if (isRunning && !g_shouldQuit) {
+            PostAccept(op);
+        }
+        return;
+    }
+
+    setsockopt(clientSocket, SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT,
+        reinterpret_cast<const char*>(&listenSocket), sizeof(listenSocket));
+
+    sockaddr* localAddr = nullptr;
+    sockaddr* remoteAddr = nullptr;
+    int localLen = 0, remoteLen = 0;
+    GetAcceptExSockaddrs(op->addrBuffer, 0, sizeof(sockaddr_in) + 16, sizeof(sockaddr_in) + 16,
+        &localAddr, &localLen, &remoteAddr, &remoteLen);
+    sockaddr_in clientAddr;
+    memcpy(&clientAddr, remoteAddr, sizeof(clientAddr));
+
+    // 先补投 accept，保持预投递数量
+    PostAccept(op);
+
+    if (!reactor->AddConnection(clientSocket, clientAddr)) {
+        closesocket(clientSocket);
+        std::cerr << "[接受连接失败] 客户端连接被拒绝" << std::endl;
+    }
+}
+
+bool IocpLoop::PostRecv(const std::shared_ptr<ClientContext>& hold) {
+    IocpClient* client = static_cast<IocpClient*>(hold.get());
+    memset(&client->recvOp.ov, 0, sizeof(client->recvOp.ov));
+    client->recvOp.hold = hold;
+
+    // 接收缓冲区环绕时用两段 WSABUF 一次收满
+    FrameSegment segments[2];
+    int count = client->decoder.WritableSegments(segments);
+    WSABUF bufs[2];
+    for (int i = 0; i < count; ++i) {
+        bufs[i].buf = segments[i].data;
+        bufs[i].len = static_cast<ULONG>(segments[i].len);
+    }
+    DWORD flags = 0;
+    pendingOps++;
+    ioCalls++;
+    client->recvInFlight = true;
+    if (WSARecv(client->clientSocket, bufs, count, NULL, &flags, &client->recvOp.ov, NULL) == SOCKET_ERROR
+        && WSAGetLastError() != WSA_IO_PENDING) {
+        pendingOps--;
+        client->recvInFlight = false;
+        client->recvOp.hold.reset();
+        return false;
+    }
+    return true;
+}
+
+// 投递 WSASend：队列中的帧一次聚集写发出（调用方须持有 sendMutex）。
+// WSABUF 数组由 Winsock 在调用时复制，可放在栈上；帧数据在完成前留在队列中。
+bool IocpLoop::PostSend(IocpClient* client) {
+    memset(&client->sendOp.ov, 0, sizeof(client->sendOp.ov));
+    client->sendOp.hold = client->shared_from_this();
+    client->sendInFlight = true;
+
+    WSABUF bufs[MAX_GATHER_BUFFERS];
+    int count = client->outbound.Gather(bufs, MAX_GATHER_BUFFERS);
+    pendingOps++;
+    ioCalls++;
+    if (WSASend(client->clientSocket, bufs, count, NULL, 0, &client->sendOp.ov, NULL) == SOCKET_ERROR
+        && WSAGetLastError() != WSA_IO_PENDING) {
+        std::cerr << "[发送失败] 错误码: " << WSAGetLastError() << std::endl;
+        pendingOps--;
+        client->sendInFlight = false;
+        client->sendOp.hold.reset();
+        return false;
+    }
+    return true;
+}
+
+void IocpLoop::OnRecvComplete(IocpIoOp* op, DWORD bytes, bool ok) {
+    std::shared_ptr<ClientContext> client = std::move(op->hold);
+    op->client->recvInFlight = false;
+    if (client->closed) return;
+
+    if (!ok || bytes == 0) {
+        HandleSocketError(client.get(), ok ? 0 : SOCKET_ERROR);
+        CloseConnection(client);
+        return;
+    }
+
+    // 一次完成可能带回多条消息，也可能只有半条；
+    // inbox 已满时不再投递 WSARecv，由处理线程消化后经 ResumeRead 恢复
+    client->decoder.Commit(bytes);
+    client->lastActive = GetTickCount64();
+    bool paused = false;
+    if (!DrainFrames(client, &paused) || (!paused && !PostRecv(client))) {
+        CloseConnection(client);
+    }
+}
+
+void IocpLoop::ResumeRead(const std::shared_ptr<ClientContext>& hold) {
+    IocpClient* client = static_cast<IocpClient*>(hold.get());
+    // 同一连接最多一个未执行的恢复请求（resumeOp 只有一个）
+    if (client->resumePosted.exchange(true)) return;
+    memset(&client->resumeOp.ov, 0, sizeof(client->resumeOp.ov));
+    client->resumeOp.hold = hold;
+    pendingOps++;
+    if (!PostQueuedCompletionStatus(completionPort, 0, 0, &client->resumeOp.ov)) {
+        pendingOps--;
+        client->resumeOp.hold.reset();
+        client->resumePosted = false;
+    }
+}
+
+// 恢复读取：分发暂停期间留在接收缓冲区中的帧，再重新投递 WSARecv。
+// 暂停时未投递 WSARecv；若仍有进行中的 WSARecv（暂停前处理线程已恢复），其完成时会继续分发
+void IocpLoop::OnResume(IocpIoOp* op) {
+    std::shared_ptr<ClientContext> client = std::move(op->hold);
+    op->client->resumePosted = false;
+    if (client->closed || op->client->recvInFlight) return;
+
+    bool paused = false;
+    if (!DrainFrames(client, &paused) || (!paused && !PostRecv(client))) {
+        CloseConnection(client);
+    }
+}
+
+void IocpLoop::OnSendComplete(IocpIoOp* op, DWORD bytes, bool ok) {
+    std::shared_ptr<ClientContext> client = std::move(op->hold);
+    IocpClient* iocpClient = op->client;
+
+    bool failed = false;
+    {
+        std::lock_guard<std::mutex> lk(client->sendMutex);
+        iocpClient->sendInFlight = false;
+        if (client->closed) return;
+
+        if (!ok) {
+            failed = true;
+        }
+        else {
+            client->outbound.Consume(bytes);
+            // 发送期间又有新消息或本次未写完时继续投递
+            if (!client->outbound.Empty()) {
+                failed = !PostSend(iocpClient);
+            }
+        }
+    }
+
+    if (failed) {
+        CloseConnection(client);
+    }
+}
+
+// 关闭连接：未完成的重叠操作会以失败返回并释放对连接的引用。
+// 发送队列不在这里清空，进行中的 WSASend 可能仍引用其中的帧，随连接一起释放。
+void IocpLoop::CloseConnection(const std::shared_ptr<ClientContext>& client) {
+    {
+        std::lock_guard<std::mutex> lk(client->sendMutex);
+        if (client->closed.exchange(true)) return;
+        closesocket(client->clientSocket);
+    }
+    {
+        std::lock_guard<std::mutex> lk(connMutex);
+        connections.erase(client.get());
+    }
+    connCount--;
+    OnConnectionClosed(client);
+}
+
+void IocpLoop::CloseAll() {
+    if (listenSocket != INVALID_SOCKET) {
+        CancelIoEx(reinterpret_cast<HANDLE>(listenSocket), NULL);
+    }
+
+    std::vector<std::shared_ptr<ClientContext>> all;
+    {
+        std::lock_guard<std::mutex> lk(connMutex);
+        for (auto& entry : connections) {
+            all.push_back(entry.second);
+        }
+    }
+    for (auto& client : all) {
+        CloseConnection(client);
+    }
+}
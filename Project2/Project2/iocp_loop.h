@@ -0,0 +1,104 @@
+﻿#pragma once
+#ifndef IOCP_LOOP_H
+#define IOCP_LOOP_H
+
+#include <unordered_map>
+#include <mswsock.h>
+#include "reactor.h"
+
+#pragma comment(lib, "mswsock.lib")
+
+// 完成端口后端配置
+const int IOCP_BATCH_SIZE = 64;             // 每次 GetQueuedCompletionStatusEx 最多取出的完成事件数
+const int IOCP_ACCEPT_BACKLOG = 32;         // 每个分片预投递的 AcceptEx 数量，完成一个立即补投一个
+const DWORD IOCP_DRAIN_TIMEOUT_MS = 1000;   // 停止时等待未完成操作返回的最长时间
+
+enum class IocpOpType { Accept, Recv, Send, Resume };
+
+// 重叠操作：OVERLAPPED 必须是第一个成员，完成事件中的 LPOVERLAPPED 可直接转换回 IocpOp
+struct IocpOp {
+    OVERLAPPED ov;
+    IocpOpType type;
+};
+
+struct IocpAcceptOp : public IocpOp {
+    SOCKET acceptSocket;                                  // 预先创建、等待 AcceptEx 填充的客户端 socket
+    char addrBuffer[2 * (sizeof(sockaddr_in) + 16)];      // 本端/对端地址
+};
+
+struct IocpClient;
+
+struct IocpIoOp : public IocpOp {
+    IocpClient* client;
+    std::shared_ptr<ClientContext> hold;                  // 操作未完成前保持连接存活
+};
+
+// 完成端口连接：在 ClientContext 基础上增加重叠操作。
+// WSARecv 直接收进连接的帧解码环形缓冲区，该缓冲区连接建立时分配、整个生命周期复用
+struct IocpClient : public ClientContext {
+    IocpIoOp recvOp;
+    IocpIoOp sendOp;
+    IocpIoOp resumeOp;          // 恢复读取：由处理线程投递到完成端口，在 I/O 线程上继续分发并重新投递 WSARecv
+    bool sendInFlight;          // 是否有进行中的 WSASend（受 sendMutex 保护），期间队首已投递的帧不可出队
+    bool recvInFlight;          // 是否有进行中的 WSARecv（仅由 I/O 线程访问），期间不能移动接收缓冲区
+
+    IocpClient(SOCKET sock, const sockaddr_in& addr)
+        : ClientContext(sock, addr), sendInFlight(false), recvInFlight(false) {
+        recvOp.type = IocpOpType::Recv;
+        recvOp.client = this;
+        sendOp.type = IocpOpType::Send;
+        sendOp.client = this;
+        resumeOp.type = IocpOpType::Resume;
+        resumeOp.client = this;
+    }
+};
+
+// 完成端口事件循环：
+// - AcceptEx 预投递多个 accept，接入无需主线程阻塞在 accept 上
+//   （一个 socket 只能关联一个完成端口，因此监听 socket 由首个分片持有，
+//    接入后按连接数分配给各分片）
+// - 每个连接始终挂一个 WSARecv，一次完成可带回多条消息
+// - 发送期间新入队的帧在上一次完成后用一次聚集 WSASend 发出
+// - GetQueuedCompletionStatusEx 一次取出一批完成事件
+class IocpLoop : public EventLoop {
+public:
+    IocpLoop(ThreadPool* handlerPool, Reactor* reactor);
+    ~IocpLoop();
+
+    bool Start() override;
+    void Stop() override;
+    void AddConnection(SOCKET clientSocket, const sockaddr_in& clientAddr) override;
+    bool SendFrame(ClientContext* client, std::string&& frame,
+                   SendPriority priority = SendPriority::Normal) override;
+    void ResumeRead(const std::shared_ptr<ClientContext>& client) override;
+
+    bool StartAccepting(SOCKET listenSocket) override;
+
+private:
+    void Run();
+    bool PostAccept(IocpAcceptOp* op);
+    bool PostRecv(const std::shared_ptr<ClientContext>& client);
+    bool PostSend(IocpClient* client);
+    void OnAcceptComplete(IocpAcceptOp* op, bool ok);
+    void OnRecvComplete(IocpIoOp* op, DWORD bytes, bool ok);
+    void OnSendComplete(IocpIoOp* op, DWORD bytes, bool ok);
+    void OnResume(IocpIoOp* op);
+    void CloseConnection(const std::shared_ptr<ClientContext>& client) override;
+    void CloseAll();
+    void ApplyNewConnections();
+
+    HANDLE completionPort;
+    std::thread ioThread;
+    std::atomic<bool> isRunning;
+    std::atomic<int> pendingOps;        // 已投递但尚未取回完成事件的操作数
+
+    SOCKET listenSocket;
+    std::vector<std::unique_ptr<IocpAcceptOp>> acceptOps;
+
+    std::mutex connMutex;
+    std::unordered_map<ClientContext*, std::shared_ptr<ClientContext>> connections;
+    // 新接入、尚未加入空闲时间轮的连接（接入可能发生在首个分片的线程上，时间轮只能由本线程访问）
+    std::vector<std::shared_ptr<ClientContext>> newConnections;
+};
+
+#endif // IOCP_LOOP_H
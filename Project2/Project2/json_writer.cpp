@@ -0,0 +1,303 @@
+﻿#include "json_writer.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// 从 value[i] 开始的合法 UTF-8 序列长度（ASCII 为 1），非法时返回 0。
+// 检查长度、后续字节与取值范围（拒绝过长编码和代理区）
+std::size_t Utf8SequenceLength(std::string_view value, std::size_t i) {
+    unsigned char c = static_cast<unsigned char>(value[i]);
+    if (c < 0x80) return 1;
+
+    std::size_t len = 0;
+    unsigned char lo = 0x80, hi = 0xBF;
+    if (c >= 0xC2 && c <= 0xDF) len = 2;
+    else if (c >= 0xE0 && c <= 0xEF) {
+        len = 3;
+        if (c == 0xE0) lo = 0xA0;
+        if (c == 0xED) hi = 0x9F;
+    }
+    else if (c >= 0xF0 && c <= 0xF4) {
+        len = 4;
+        if (c == 0xF0) lo = 0x90;
+        if (c == 0xF4) hi = 0x8F;
+    }
+
+    if (len == 0 || i + len > value.size()) return 0;
+    for (std::size_t k = 1; k < len; ++k) {
+        unsigned char cc = static_cast<unsigned char>(value[i + k]);
+        if (k == 1 ? (cc < lo || cc > hi) : (cc < 0x80 || cc > 0xBF)) return 0;
+    }
+    return len;
+}
+
+} // namespace
+
+void JsonWriter::Separator() {
+    if (afterKey) {
+        afterKey = false;
+        return;
+    }
+    if (msgpack) {
+        if (depth > 0) stack[depth - 1].count++;
+        return;
+    }
+    if (!first) out.push_back(',');
+    first = false;
+}
+
+JsonWriter& JsonWriter::BeginObject() {
+    Separator();
+    if (msgpack) {
+        BeginContainer(0x80);
+        return *this;
+    }
+    out.push_back('{');
+    first = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndObject() {
+    if (msgpack) {
+        EndContainer(0xde, 0xdf);
+        return *this;
+    }
+    out.push_back('}');
+    first = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::BeginArray() {
+    Separator();
+    if (msgpack) {
+        BeginContainer(0x90);
+        return *this;
+    }
+    out.push_back('[');
+    first = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndArray() {
+    if (msgpack) {
+        EndContainer(0xdc, 0xdd);
+        return *this;
+    }
+    out.push_back(']');
+    first = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::Key(std::string_view key) {
+    Separator();
+    if (msgpack) {
+        PackString(key);
+    }
+    else {
+        Escape(key);
+        out.push_back(':');
+    }
+    afterKey = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::String(std::string_view value) {
+    Separator();
+    if (msgpack) {
+        PackString(value);
+        return *this;
+    }
+    Escape(value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Int(long long value) {
+    Separator();
+    if (msgpack) {
+        // 与 json::to_msgpack 一致：选择能容纳该值的最短格式
+        if (value >= 0) {
+            unsigned long long u = static_cast<unsigned long long>(value);
+            if (u <= 0x7F) out.push_back(static_cast<char>(u));
+            else if (u <= 0xFF) PackBigEndian(0xcc, u, 1);
+            else if (u <= 0xFFFF) PackBigEndian(0xcd, u, 2);
+            else if (u <= 0xFFFFFFFFull) PackBigEndian(0xce, u, 4);
+            else PackBigEndian(0xcf, u, 8);
+        }
+        else {
+            unsigned long long u = static_cast<unsigned long long>(value);
+            if (value >= -32) out.push_back(static_cast<char>(value));
+            else if (value >= INT8_MIN) PackBigEndian(0xd0, u, 1);
+            else if (value >= INT16_MIN) PackBigEndian(0xd1, u, 2);
+            else if (value >= INT32_MIN) PackBigEndian(0xd2, u, 4);
+            else PackBigEndian(0xd3, u, 8);
+        }
+        return *this;
+    }
+    char buf[24];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, result.ptr);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Double(double value) {
+    Separator();
+    if (msgpack) {
+        // 价格等浮点数一律写 float64，不做可能丢精度的 float32 压缩
+        unsigned long long bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        PackBigEndian(0xcb, bits, 8);
+        return *this;
+    }
+    if (!std::isfinite(value)) {
+        out.append("null");
+        return *this;
+    }
+    char buf[32];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    std::string_view text(buf, result.ptr - buf);
+    out.append(text);
+    // 与 nlohmann 的输出保持一致：整数值的浮点数带 ".0"
+    if (text.find_first_of(".eE") == std::string_view::npos) {
+        out.append(".0");
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::Bool(bool value) {
+    Separator();
+    if (msgpack) {
+        out.push_back(static_cast<char>(value ? 0xc3 : 0xc2));
+        return *this;
+    }
+    out.append(value ? "true" : "false");
+    return *this;
+}
+
+JsonWriter& JsonWriter::Null() {
+    Separator();
+    if (msgpack) {
+        out.push_back(static_cast<char>(0xc0));
+        return *this;
+    }
+    out.append("null");
+    return *this;
+}
+
+void AppendJson(std::string& frame, const nlohmann::json& value, int encoding) {
+    if (encoding == ChatMessage::body_msgpack) {
+        nlohmann::json::to_msgpack(value, nlohmann::detail::output_adapter<char, std::string>(frame));
+        return;
+    }
+    nlohmann::detail::serializer<nlohmann::json> serializer(
+        nlohmann::detail::output_adapter<char, std::string>(frame), ' ',
+        nlohmann::json::error_handler_t::replace);
+    serializer.dump(value, false, false, 0);
+}
+
+// 写出带引号的转义字符串，同时校验 UTF-8
+void JsonWriter::Escape(std::string_view value) {
+    static const char HEX[] = "0123456789abcdef";
+    out.push_back('"');
+
+    const std::size_t n = value.size();
+    std::size_t i = 0;
+    while (i < n) {
+        unsigned char c = static_cast<unsigned char>(value[i]);
+        if (c < 0x80) {
+            switch (c) {
+            case '"':  out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\b': out.append("\\b"); break;
+            case '\f': out.append("\\f"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            default:
+                if (c < 0x20) {
+                    char esc[6] = { '\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0xF] };
+                    out.append(esc, sizeof(esc));
+                }
+                else {
+                    out.push_back(static_cast<char>(c));
+                }
+            }
+            ++i;
+            continue;
+        }
+
+        // 多字节序列
+        std::size_t len = Utf8SequenceLength(value, i);
+        if (len > 0) {
+            out.append(value.data() + i, len);
+            i += len;
+        }
+        else {
+            out.append("\xEF\xBF\xBD");
+            ++i;
+        }
+    }
+    out.push_back('"');
+}
+
+// 容器头先按 fixmap/fixarray 占 1 字节，End 时元素个数超过 15 再就地扩展为 16/32 位格式
+void JsonWriter::BeginContainer(unsigned char fixMarker) {
+    if (depth < MSGPACK_MAX_DEPTH) {
+        stack[depth] = Container{ out.size(), 0 };
+    }
+    ++depth;
+    out.push_back(static_cast<char>(fixMarker));
+}
+
+void JsonWriter::EndContainer(unsigned char marker16, unsigned char marker32) {
+    --depth;
+    if (depth >= MSGPACK_MAX_DEPTH) return;
+    const Container& c = stack[depth];
+    unsigned char* head = reinterpret_cast<unsigned char*>(&out[c.offset]);
+    if (c.count <= 15) {
+        *head = static_cast<unsigned char>(*head | c.count);
+        return;
+    }
+
+    char extended[5];
+    int bytes = c.count <= 0xFFFF ? 2 : 4;
+    extended[0] = static_cast<char>(bytes == 2 ? marker16 : marker32);
+    for (int k = 0; k < bytes; ++k) {
+        extended[1 + k] = static_cast<char>((c.count >> (8 * (bytes - 1 - k))) & 0xFF);
+    }
+    out.replace(c.offset, 1, extended, 1 + bytes);
+}
+
+// 字符串同样做 UTF-8 校验：合法时直接写出，含非法字节时先替换再写（长度需要提前确定）
+void JsonWriter::PackString(std::string_view value) {
+    std::string replaced;
+    for (std::size_t i = 0; i < value.size();) {
+        std::size_t len = Utf8SequenceLength(value, i);
+        if (len == 0) {
+            if (replaced.empty()) replaced.assign(value.data(), i);
+            replaced.append("\xEF\xBF\xBD");
+            ++i;
+            continue;
+        }
+        if (!replaced.empty()) replaced.append(value.data() + i, len);
+        i += len;
+    }
+    if (!replaced.empty()) value = replaced;
+
+    std::size_t n = value.size();
+    if (n <= 31) out.push_back(static_cast<char>(0xa0 | n));
+    else if (n <= 0xFF) PackBigEndian(0xd9, n, 1);
+    else if (n <= 0xFFFF) PackBigEndian(0xda, n, 2);
+    else PackBigEndian(0xdb, n, 4);
+    out.append(value.data(), n);
+}
+
+void JsonWriter::PackBigEndian(unsigned char marker, unsigned long long value, int bytes) {
+    char buf[9];
+    buf[0] = static_cast<char>(marker);
+    for (int k = 0; k < bytes; ++k) {
+        buf[1 + k] = static_cast<char>((value >> (8 * (bytes - 1 - k))) & 0xFF);
+    }
+    out.append(buf, 1 + bytes);
+}
@@ -0,0 +1,80 @@
+﻿#pragma once
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <string>
+#include <string_view>
+#include "base.h"
+
+// MessagePack 模式下允许的最大嵌套层数（固定结构的消息远小于此）
+const int MSGPACK_MAX_DEPTH = 16;
+
+// 新建帧时预留的容量：通用响应与告警推送都远小于此，整个帧只需一次分配
+const std::size_t FRAME_INITIAL_RESERVE = 256;
+
+// 开始一个发送帧：预留消息头位置，消息体直接追加在其后。
+// 消息头由 EventLoop::SendFrame 按连接当前的帧格式填写，帧随后整体移入发送队列，不再复制
+inline void BeginFrame(std::string& frame, std::size_t reserve = FRAME_INITIAL_RESERVE) {
+    frame.clear();
+    frame.reserve(ChatMessage::header_length + reserve);
+    frame.append(ChatMessage::header_length, '\0');
+}
+
+// 流式 JSON 写出器：把固定结构的消息直接序列化到给定字符串末尾，
+// 不构造 nlohmann::json 对象、不产生临时字符串。
+// encoding 为 ChatMessage::body_msgpack 时写出同样结构的 MessagePack（与 json::to_msgpack 可互相解析），
+// 对象/数组的元素个数在 End 时回填到容器头部。
+// 调用方负责保证 Begin/End 配对、对象中先 Key 后值。
+// 非法 UTF-8 字节替换为 U+FFFD（与 dump 的 error_handler_t::replace 一致）
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out, int encoding = ChatMessage::body_json)
+        : out(out), msgpack(encoding == ChatMessage::body_msgpack), first(true), afterKey(false), depth(0) {}
+
+    JsonWriter& BeginObject();
+    JsonWriter& EndObject();
+    JsonWriter& BeginArray();
+    JsonWriter& EndArray();
+    JsonWriter& Key(std::string_view key);
+
+    JsonWriter& String(std::string_view value);
+    JsonWriter& Int(long long value);
+    JsonWriter& Double(double value);
+    JsonWriter& Bool(bool value);
+    JsonWriter& Null();
+
+    // 常用的键值对简写
+    JsonWriter& Field(std::string_view key, std::string_view value) { return Key(key).String(value); }
+    JsonWriter& Field(std::string_view key, const char* value) { return Key(key).String(value); }
+    JsonWriter& Field(std::string_view key, long long value) { return Key(key).Int(value); }
+    JsonWriter& Field(std::string_view key, int value) { return Key(key).Int(value); }
+    JsonWriter& Field(std::string_view key, double value) { return Key(key).Double(value); }
+
+private:
+    void Separator();
+    void Escape(std::string_view value);
+
+    // MessagePack 编码
+    void BeginContainer(unsigned char fixMarker);
+    void EndContainer(unsigned char marker16, unsigned char marker32);
+    void PackString(std::string_view value);
+    void PackBigEndian(unsigned char marker, unsigned long long value, int bytes);
+
+    struct Container {
+        std::size_t offset;     // 容器头部在 out 中的位置
+        uint32_t count;         // 已写出的元素个数（对象按键计）
+    };
+
+    std::string& out;
+    bool msgpack;
+    bool first;         // 当前对象/数组中还没有元素
+    bool afterKey;      // 刚写完键，下一个值前不加逗号（MessagePack 模式下不计入元素个数）
+    Container stack[MSGPACK_MAX_DEPTH];
+    int depth;
+};
+
+// 把 DOM 直接序列化追加到帧中（结构不固定的响应使用），省去 dump 产生的临时字符串。
+// encoding 为 ChatMessage::body_msgpack 时写出 MessagePack
+void AppendJson(std::string& frame, const nlohmann::json& value, int encoding = ChatMessage::body_json);
+
+#endif // JSON_WRITER_H
@@ -10,13 +10,18 @@
 #include "MarketSeverce.h"
 #include "threadpool.h"
 #include "router.h"
+#include "hot_upgrade.h"
+#include "alert_state_writer.h"
 
 //bool g_shouldQuit = false;
 //SOCKET g_listenSocket = INVALID_SOCKET;
 //ThreadPool* g_pThreadPool = nullptr;
 
 
-int main() {
+int main(int argc, char* argv[]) {
+    // 热升级：--takeover 从正在运行的旧进程接管连接，接管后的进程同样允许被再次接管
+    bool takeover = ParseTakeover(argc, argv);
+    bool hotUpgrade = takeover || ParseHotUpgrade(argc, argv);
     ////������̨�̣߳���������
     //HANDLE hThread = CreateThread(
     //    NULL,               // Ĭ�ϰ�ȫ����
@@ -27,8 +32,6 @@ int main() {
     //    NULL                // ����Ҫ�߳� ID
     //);
 
-    StartMarketService();
-
 
     // ��ʼ��Winsock
     if (!InitWinsock()) {
@@ -53,42 +56,84 @@ int main() {
         return 1;
     }
 
+    // 预警单状态回写：预警触发和 alert_ack 的数据库更新由执行器上的回写任务批量写入，需在线程池启动后再启动
+    AlertStateWriter::Instance().Start();
+
+    // 启动 I/O 线程（Reactor），负责所有客户端 socket 的非阻塞收发
+    // v4 帧最大消息体长度：--max-frame-bytes=N
+    std::size_t maxFrameBytes = ParseMaxFrameBytes(argc, argv);
+    if (maxFrameBytes > 0) {
+        ChatMessage::set_max_frame_length(maxFrameBytes);
+    }
+
+    // 网络后端：--io=poll（默认）或 --io=iocp
+    Reactor reactor(&threadPool, ParseIoBackend(argc, argv));
+    g_pReactor = &reactor;
+    // 空闲超时：--idle-timeout=秒，0 表示不检测
+    reactor.SetIdleTimeout(ParseIdleTimeout(argc, argv));
+    if (!reactor.Start()) {
+        threadPool.Stop();
+        WSACleanup();
+        return 1;
+    }
+
     // ��������Socket
-    g_listenSocket = CreateListenSocket();
+    if (takeover) {
+        // 接管旧进程的监听 socket 和客户端连接，客户端无需重连、重新登录
+        std::vector<std::shared_ptr<ClientContext>> handed;
+        if (reactor.Backend() == IoBackend::Poll && TakeOverFromRunningServer(LISTEN_PORT, g_listenSocket, handed)) {
+            for (auto& client : handed) {
+                if (!reactor.AdoptConnection(client)) {
+                    closesocket(client->clientSocket);
+                    continue;
+                }
+                FuturesAlertServer::resumeUserWatcher(client->userToken, client->userId, client);
+            }
+        }
+        else {
+            std::cerr << "[热升级失败] 接管需使用 --io=poll 且旧进程以 --hot-upgrade 启动" << std::endl;
+        }
+    }
+    else {
+        g_listenSocket = CreateListenSocket();
+    }
     if (g_listenSocket == INVALID_SOCKET) {
+        reactor.Stop();
         threadPool.Stop();
         WSACleanup();
         return 1;
     }
 
+    // 行情服务的告警通知运行在线程池的执行器上，需在线程池启动后再启动。
+    // 热升级时在接管完成后才启动：旧进程此时已停止预警判断并写完已触发的状态，
+    // 这里加载的预警缓存不会与旧进程重复触发
+    StartMarketService();
+
     // ���ܿͻ�������
+    // 各 I/O 分片在监听 socket 上自行接入连接，主线程只等待退出
+    if (!reactor.StartAccepting(g_listenSocket)) {
+        g_shouldQuit = true;
+    }
+    HotUpgradeListener upgrade;
+    if (hotUpgrade) {
+        upgrade.Start(LISTEN_PORT);
+    }
     while (!g_shouldQuit) {
-        sockaddr_in clientAddr;
-        int clientAddrLen = sizeof(clientAddr);
-        SOCKET clientSocket = accept(g_listenSocket, (sockaddr*)&clientAddr, &clientAddrLen);
-
-        if (clientSocket == INVALID_SOCKET) {
-            if (g_shouldQuit) break;
-            std::cerr << "[接受连接失败] 错误码: " << WSAGetLastError() << std::endl;
-            continue;
-        }
-
-        // 注意：使用阻塞模式，与 HandleClient 中的同步 recv 配合
-        // 如果需要非阻塞，请修改 HandleClient 使用 select/poll 或异步 IO
-        // u_long mode = 1;
-        // ioctlsocket(clientSocket, FIONBIO, &mode);
-
-        // 添加任务到线程池
-        ClientContext* client = new ClientContext(clientSocket, clientAddr);
-        if (!threadPool.AddTask(client)) {
-            delete client;
-            closesocket(clientSocket);
-            std::cerr << "[��������ʧ��] �޷�����������" << std::endl;
+        // 新进程请求接管：交出连接后本进程处理完剩余任务即退出
+        if (upgrade.Requested() && upgrade.Handoff(reactor, g_listenSocket)) {
+            g_shouldQuit = true;
+            break;
         }
+        AlertStateWriter::Instance().RetryIfDue();
+        Sleep(100);
     }
+    upgrade.Stop();
 
     // ������Դ
+    reactor.Stop();
     threadPool.Stop();
+    // 请求处理结束后再写完剩余的预警状态
+    AlertStateWriter::Instance().Stop();
     if (g_listenSocket != INVALID_SOCKET) {
         closesocket(g_listenSocket);
     }
@@ -0,0 +1,100 @@
+﻿#include "outbound_queue.h"
+
+PushResult OutboundQueue::Push(std::string&& frame, SendPriority priority) {
+    if (overflowed) return PushResult::Rejected;
+
+    std::size_t frames = PendingFrames();
+    bool overLimit = frames > 0 &&
+        (bytes + frame.size() > OUTBOUND_MAX_BYTES || frames + 1 > OUTBOUND_MAX_FRAMES);
+    if (overLimit) {
+        bool withinReserve = priority == SendPriority::Alert &&
+            bytes + frame.size() <= OUTBOUND_MAX_BYTES + OUTBOUND_ALERT_RESERVE_BYTES &&
+            frames + 1 <= OUTBOUND_MAX_FRAMES + OUTBOUND_ALERT_RESERVE_FRAMES;
+        if (!withinReserve) {
+            overflowed = true;
+            return PushResult::Overflow;
+        }
+    }
+
+    bytes += frame.size();
+    lanes[static_cast<int>(priority)].push_back(std::move(frame));
+    return overLimit ? PushResult::QueuedInReserve : PushResult::Queued;
+}
+
+int OutboundQueue::Gather(WSABUF* bufs, int maxBufs) {
+    // 先按优先级把帧移入发送区，再统一取地址（短字符串移动后数据地址会变）
+    for (int p = 0; p < SEND_PRIORITY_COUNT; ++p) {
+        std::deque<std::string>& lane = lanes[p];
+        while (!lane.empty() && sending.size() < static_cast<std::size_t>(maxBufs)) {
+            sending.push_back(SendingFrame{ std::move(lane.front()), static_cast<SendPriority>(p) });
+            lane.pop_front();
+        }
+    }
+
+    int count = 0;
+    std::size_t skip = offset;
+    for (auto it = sending.begin(); it != sending.end() && count < maxBufs; ++it) {
+        bufs[count].buf = const_cast<char*>(it->data.data()) + skip;
+        bufs[count].len = static_cast<ULONG>(it->data.size() - skip);
+        skip = 0;
+        ++count;
+    }
+    return count;
+}
+
+void OutboundQueue::Consume(std::size_t n) {
+    bytes -= n;
+    while (n > 0 && !sending.empty()) {
+        std::size_t remain = sending.front().data.size() - offset;
+        if (n < remain) {
+            offset += n;
+            break;
+        }
+        n -= remain;
+        sending.pop_front();
+        offset = 0;
+    }
+
+    // 只保留发送了一部分的队首帧，其余放回各自队列的开头（保持原有顺序）
+    std::size_t keep = offset > 0 ? 1 : 0;
+    while (sending.size() > keep) {
+        SendingFrame& frame = sending.back();
+        lanes[static_cast<int>(frame.priority)].push_front(std::move(frame.data));
+        sending.pop_back();
+    }
+}
+
+void OutboundQueue::TakeAll(std::vector<std::string>& out, std::vector<SendPriority>& priorities) {
+    if (!sending.empty() && offset > 0) {
+        sending.front().data.erase(0, offset);
+    }
+    for (auto& frame : sending) {
+        out.push_back(std::move(frame.data));
+        priorities.push_back(SendPriority::Alert);
+    }
+    for (int p = 0; p < SEND_PRIORITY_COUNT; ++p) {
+        for (auto& frame : lanes[p]) {
+            out.push_back(std::move(frame));
+            priorities.push_back(static_cast<SendPriority>(p));
+        }
+    }
+    Clear();
+}
+
+void OutboundQueue::Clear() {
+    sending.clear();
+    for (auto& lane : lanes) {
+        lane.clear();
+    }
+    offset = 0;
+    bytes = 0;
+    overflowed = false;
+}
+
+std::size_t OutboundQueue::PendingFrames() const {
+    std::size_t count = sending.size();
+    for (const auto& lane : lanes) {
+        count += lane.size();
+    }
+    return count;
+}
@@ -0,0 +1,80 @@
+﻿#pragma once
+#ifndef OUTBOUND_QUEUE_H
+#define OUTBOUND_QUEUE_H
+
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+// 单次聚集写（WSASend）最多携带的帧数
+const int MAX_GATHER_BUFFERS = 64;
+
+// 发送优先级：数值越小越先发送
+enum class SendPriority {
+    Alert = 0,      // 预警触发推送，交易员最在意的延迟
+    Normal = 1,     // 请求响应（包括 query_warnings 的分页等大块数据）
+};
+const int SEND_PRIORITY_COUNT = 2;
+
+// 慢消费者保护：客户端停止读取时，每连接最多为其排队的数据量
+const std::size_t OUTBOUND_MAX_BYTES = 4 * 1024 * 1024;         // 普通响应的字节上限
+const std::size_t OUTBOUND_MAX_FRAMES = 4096;                   // 普通响应的帧数上限
+const std::size_t OUTBOUND_ALERT_RESERVE_BYTES = 512 * 1024;    // 超过上限后仍为告警推送保留的字节额度
+const std::size_t OUTBOUND_ALERT_RESERVE_FRAMES = 512;          // 超过上限后仍为告警推送保留的帧数额度
+
+// 入队结果
+enum class PushResult {
+    Queued,             // 正常入队
+    QueuedInReserve,    // 普通额度已满，告警推送使用保留额度入队
+    Overflow,           // 本次超出上限，帧被拒绝，连接应断开
+    Rejected            // 此前已超出上限，等待断开期间的帧一律拒绝
+};
+
+// 每连接发送队列：响应和告警推送都以完整帧入队，由 I/O 线程用一次聚集写发出多帧。
+// 每个优先级一条队列，聚集写时先取高优先级，告警推送可越过排队中的大块响应；
+// 已经开始发送的帧不会被打断，帧永远完整发出。
+// 队列有上限：告警推送从不丢弃（普通额度用完后还有保留额度），
+// 其他帧超出上限即判定为慢消费者，由调用方断开连接，不让一个卡住的客户端无限占用内存。
+// 本身不加锁，由 ClientContext::sendMutex 保护。
+class OutboundQueue {
+public:
+    OutboundQueue() : offset(0), bytes(0), overflowed(false) {}
+
+    // 队列为空时总能入队（单个大帧不受字节上限限制）
+    PushResult Push(std::string&& frame, SendPriority priority = SendPriority::Normal);
+
+    // 按优先级取若干帧（已开始发送的帧排在最前，并跳过已发送部分）填充 WSABUF 数组，返回使用的个数。
+    // 取出的帧在 Consume 之前固定顺序，其间新入队的帧不会插到它们前面
+    int Gather(WSABUF* bufs, int maxBufs);
+
+    // 已发送 n 字节后调用，弹出已完整发送的帧；上次取出但一个字节都未发出的帧放回原队列，
+    // 下次聚集写时重新按优先级排序
+    void Consume(std::size_t n);
+
+    void Clear();
+
+    // 取出全部未发送的帧（首帧去掉已发送的部分）及各自的优先级并清空队列，用于热升级交接。
+    // 已由 Gather 取出的帧按 Alert 返回：按顺序重新入队后仍排在最前，不会被其他帧插入到已发出一部分的帧中间
+    void TakeAll(std::vector<std::string>& out, std::vector<SendPriority>& priorities);
+
+    bool Empty() const { return PendingFrames() == 0; }
+    std::size_t PendingBytes() const { return bytes; }
+    std::size_t PendingFrames() const;
+    bool Overflowed() const { return overflowed; }
+
+private:
+    struct SendingFrame {
+        std::string data;
+        SendPriority priority;
+    };
+
+    std::deque<std::string> lanes[SEND_PRIORITY_COUNT];     // 尚未取出的帧，按优先级分队
+    std::deque<SendingFrame> sending;   // 已由 Gather 取出、正在发送的帧；deque 尾部入队不会移动已有元素
+    std::size_t offset;                 // sending 队首帧已发送的字节数
+    std::size_t bytes;                  // 尚未发送的总字节数
+    bool overflowed;                    // 曾超出上限，之后不再接受新帧
+};
+
+#endif // OUTBOUND_QUEUE_H
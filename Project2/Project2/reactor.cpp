@@ -0,0 +1,813 @@
+﻿#include "reactor.h"
+#include "iocp_loop.h"
+#include "connection_pool.h"
+#include "frame_compress.h"
+#include "threadpool.h"
+#include <algorithm>
+
+Reactor* g_pReactor = nullptr;
+
+IoBackend ParseIoBackend(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--io=iocp") == 0) return IoBackend::Iocp;
+        if (strcmp(argv[i], "--io=poll") == 0) return IoBackend::Poll;
+    }
+    return IoBackend::Poll;
+}
+
+const char* IoBackendName(IoBackend backend) {
+    return backend == IoBackend::Iocp ? "iocp" : "poll";
+}
+
+std::size_t ParseMaxFrameBytes(int argc, char* argv[]) {
+    const char* prefix = "--max-frame-bytes=";
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], prefix, strlen(prefix)) == 0) {
+            return static_cast<std::size_t>(strtoull(argv[i] + strlen(prefix), NULL, 10));
+        }
+    }
+    return 0;
+}
+
+int ParseIdleTimeout(int argc, char* argv[]) {
+    const char* prefix = "--idle-timeout=";
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], prefix, strlen(prefix)) == 0) {
+            return atoi(argv[i] + strlen(prefix));
+        }
+    }
+    return IDLE_TIMEOUT_SECONDS;
+}
+
+// ==========================================
+// EventLoop 基类实现（各后端共用的协议处理）
+// ==========================================
+
+EventLoop::EventLoop(ThreadPool* handlerPool, Reactor* reactor)
+    : handlerPool(handlerPool), reactor(reactor), connCount(0), ioCalls(0), requests(0), idleEvictions(0),
+      alertReserveFrames(0), rejectedFrames(0), slowConsumerDisconnects(0) {
+}
+
+// 把响应编码为完整的帧（消息头 + 消息体），帧格式由客户端协商的版本决定
+bool EventLoop::Send(ClientContext* client, const std::string& responseData, SendPriority priority) {
+    std::string frame;
+    BeginFrame(frame, responseData.size());
+    frame.append(responseData);
+    return SendFrame(client, std::move(frame), priority);
+}
+
+bool EventLoop::FinishFrame(ClientContext* client, std::string& frame) {
+    // 检查响应长度
+    int version = client->frameVersion;
+    std::size_t bodyLength = frame.size() - ChatMessage::header_length;
+    std::size_t maxLength = ChatMessage::max_length_for(version);
+    if (bodyLength > maxLength) {
+        std::cerr << "[响应过长] 超过最大长度: " << maxLength << std::endl;
+        return false;
+    }
+
+    // 消息体编码按内容判断（同一连接协商前后的响应可能交错发出），MessagePack 只能用 v4 帧承载
+    uint32_t flags = 0;
+    if (ChatMessage::is_msgpack_body(frame.data() + ChatMessage::header_length, bodyLength)) {
+        if (version < ChatMessage::frame_v4) {
+            std::cerr << "[响应编码错误] v3 帧不能携带 MessagePack 消息体" << std::endl;
+            return false;
+        }
+        flags = ChatMessage::v4_flag_msgpack;
+    }
+
+    // 协商了压缩的连接（必为 v4）：大帧压缩后发送，压缩不划算时按原样发送
+    if (client->compressFrames && version >= ChatMessage::frame_v4 && bodyLength >= FRAME_COMPRESS_THRESHOLD) {
+        std::string packed;
+        if (CompressFrame(frame, packed)) {
+            frame.swap(packed);
+            bodyLength = frame.size() - ChatMessage::header_length;
+            flags |= ChatMessage::v4_flag_deflate;
+        }
+    }
+
+    ChatMessage::format_header(&frame[0], bodyLength, version, flags);
+    return true;
+}
+
+bool EventLoop::EnqueueFrame(ClientContext* client, std::string&& frame, SendPriority priority) {
+    switch (client->outbound.Push(std::move(frame), priority)) {
+    case PushResult::Queued:
+        return true;
+    case PushResult::QueuedInReserve:
+        alertReserveFrames++;
+        return true;
+    case PushResult::Overflow: {
+        rejectedFrames++;
+        slowConsumerDisconnects++;
+        client->sendOverflow = true;
+        char clientIP[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &(client->clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
+        std::cerr << "[慢消费者] " << clientIP << ":" << ntohs(client->clientAddr.sin_port)
+            << " 待发送: " << client->outbound.PendingBytes() << " 字节/"
+            << client->outbound.PendingFrames() << " 帧，断开连接" << std::endl;
+        return false;
+    }
+    case PushResult::Rejected:
+    default:
+        rejectedFrames++;
+        return false;
+    }
+}
+
+// 取出接收缓冲区中所有完整的帧并分发，不完整的帧留待下次读取
+bool EventLoop::DrainFrames(const std::shared_ptr<ClientContext>& client, bool* paused) {
+    std::string body;
+    if (paused) *paused = false;
+    while (true) {
+        // 读取背压：inbox 已满时停止分发，剩余的帧等处理线程消化后再取
+        if (client->readPaused) {
+            if (paused) *paused = true;
+            return true;
+        }
+        int version = ChatMessage::frame_v3;
+        uint32_t flags = 0;
+        // 登录之前只接受 v3 帧和小的 v4 帧
+        bool authenticated = client->authenticated;
+        std::size_t maxBody = authenticated ? ChatMessage::max_frame_length() : PREAUTH_MAX_BODY_LENGTH;
+        FrameDecoder::Result result = client->decoder.Next(body, maxBody, &version, &flags);
+        if (result == FrameDecoder::Result::NeedMore) return true;
+        if (result == FrameDecoder::Result::BadHeader) {
+            std::cerr << "[协议错误] 无效的消息头" << std::endl;
+            return false;
+        }
+        if (result == FrameDecoder::Result::TooLarge) {
+            std::cerr << "[协议错误] " << (authenticated ? "已登录" : "登录前") << "的帧超过 " << maxBody << " 字节" << std::endl;
+            return false;
+        }
+        if (flags & ChatMessage::v4_flag_deflate) {
+            // 只有登录时协商了压缩的连接才解压，否则一个未登录的客户端就能用很小的压缩帧占用大量内存
+            if (!client->compressFrames) {
+                std::cerr << "[协议错误] 未协商压缩的连接发来压缩帧" << std::endl;
+                return false;
+            }
+            std::string raw;
+            if (!DecompressBody(body, raw)) {
+                std::cerr << "[协议错误] 压缩的消息体无法解压" << std::endl;
+                return false;
+            }
+            body.swap(raw);
+        }
+        // 客户端发来 v4 帧说明它支持 v4，之后的响应也改用 v4
+        if (version == ChatMessage::frame_v4) {
+            client->frameVersion = ChatMessage::frame_v4;
+        }
+        DispatchRequest(client, std::move(body));
+    }
+}
+
+// 把完整请求交给处理线程池：
+// 只读查询和告警确认作为独立任务投递，可与同一连接的其他请求并行执行；
+// 其余请求放入客户端 inbox，客户端不在处理队列中时再投递一个有序通道任务
+void EventLoop::DispatchRequest(const std::shared_ptr<ClientContext>& client, std::string&& body) {
+    bool needSchedule = false;
+    requests++;
+    if (ClassifyRequest(body) == RequestLane::Parallel) {
+        if (client->parallelInflight.fetch_add(1) < MAX_PARALLEL_REQUESTS_PER_CLIENT) {
+            if (!handlerPool->AddTask(RequestJob(client, std::move(body), RequestLane::Parallel))) {
+                client->parallelInflight--;
+                std::cerr << "[添加任务失败] 处理线程池未运行" << std::endl;
+            }
+            return;
+        }
+        // 并行通道已满，退回有序通道
+        client->parallelInflight--;
+    }
+    {
+        std::lock_guard<std::mutex> lk(client->inboxMutex);
+        client->inboxBytes += body.size();
+        client->inbox.push_back(std::move(body));
+        if (client->inbox.size() >= INBOX_MAX_FRAMES || client->inboxBytes >= INBOX_MAX_BYTES) {
+            client->readPaused = true;
+        }
+        if (!client->scheduled) {
+            client->scheduled = true;
+            needSchedule = true;
+        }
+    }
+    if (needSchedule && !handlerPool->AddTask(RequestJob(client, std::string(), RequestLane::Ordered))) {
+        std::cerr << "[添加任务失败] 处理线程池未运行" << std::endl;
+    }
+}
+
+// 连接关闭后的会话清理
+void EventLoop::OnConnectionClosed(const std::shared_ptr<ClientContext>& client) {
+    std::string token;
+    {
+        std::lock_guard<std::mutex> lk(client->sessionMutex);
+        token = client->userToken;
+    }
+    FuturesAlertServer::stopUserWatcher(token);
+
+    char clientIP[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &(client->clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
+    std::cout << "[连接关闭] IP: " << clientIP << ", 端口: " << ntohs(client->clientAddr.sin_port) << std::endl;
+}
+
+// 推进空闲时间轮，关闭超时未收到任何数据（包括心跳）的连接，释放半开连接占用的资源
+void EventLoop::CheckIdleConnections() {
+    if (!idleWheel.Enabled()) return;
+
+    std::vector<std::shared_ptr<ClientContext>> expired;
+    idleWheel.Advance(GetTickCount64(), expired);
+    for (auto& client : expired) {
+        char clientIP[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &(client->clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
+        std::cout << "[空闲超时] IP: " << clientIP << ", 端口: " << ntohs(client->clientAddr.sin_port) << std::endl;
+        idleEvictions++;
+        CloseConnection(client);
+    }
+}
+
+// 处理Socket错误
+void EventLoop::HandleSocketError(ClientContext* client, int bytesRead) {
+    char clientIP[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &(client->clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
+    uint16_t clientPort = ntohs(client->clientAddr.sin_port);
+
+    if (bytesRead == 0) {
+        std::cout << "[客户端断开] IP: " << clientIP << ", 端口: " << clientPort << std::endl;
+    }
+    else {
+        int err = WSAGetLastError();
+        if (err != WSAEWOULDBLOCK) {
+            std::cerr << "[接收错误] 客户端 " << clientIP << ":" << clientPort
+                << " 错误码: " << err << std::endl;
+        }
+    }
+}
+
+// ==========================================
+// PollLoop 类实现
+// ==========================================
+
+PollLoop::PollLoop(ThreadPool* handlerPool, Reactor* reactor)
+    : EventLoop(handlerPool, reactor), isRunning(false), wakeupSocket(INVALID_SOCKET), wakeupPending(false),
+      listenSocket(INVALID_SOCKET) {
+}
+
+PollLoop::~PollLoop() {
+    Stop();
+}
+
+bool PollLoop::Start() {
+    if (isRunning) return true;
+
+    // 创建绑定在回环地址上并连接到自身的 UDP socket，向它发送 1 字节即可唤醒 WSAPoll
+    wakeupSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (wakeupSocket == INVALID_SOCKET) {
+        std::cerr << "[唤醒Socket创建失败] 错误码: " << WSAGetLastError() << std::endl;
+        return false;
+    }
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = 0;
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    int addrLen = sizeof(addr);
+    u_long mode = 1;
+    if (::bind(wakeupSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR ||
+        getsockname(wakeupSocket, reinterpret_cast<sockaddr*>(&addr), &addrLen) == SOCKET_ERROR ||
+        connect(wakeupSocket, reinterpret_cast<sockaddr*>(&addr), addrLen) == SOCKET_ERROR ||
+        ioctlsocket(wakeupSocket, FIONBIO, &mode) == SOCKET_ERROR) {
+        std::cerr << "[唤醒Socket初始化失败] 错误码: " << WSAGetLastError() << std::endl;
+        closesocket(wakeupSocket);
+        wakeupSocket = INVALID_SOCKET;
+        return false;
+    }
+
+    // 热升级交接失败后重新启动时，Detach 留下的唤醒标记对应已关闭的旧 socket
+    wakeupPending = false;
+    isRunning = true;
+    ioThread = std::thread([this]() { Run(); });
+    return true;
+}
+
+void PollLoop::Stop() {
+    if (!isRunning.exchange(false)) return;
+
+    Wakeup();
+    if (ioThread.joinable()) {
+        ioThread.join();
+    }
+
+    for (auto& client : connections) {
+        CloseConnection(client);
+    }
+    connections.clear();
+
+    std::lock_guard<std::mutex> lk(pendingMutex);
+    for (auto& client : pendingConnections) {
+        CloseConnection(client);
+    }
+    pendingConnections.clear();
+    resumedConnections.clear();
+    connCount = 0;
+
+    if (wakeupSocket != INVALID_SOCKET) {
+        closesocket(wakeupSocket);
+        wakeupSocket = INVALID_SOCKET;
+    }
+}
+
+bool PollLoop::StartAccepting(SOCKET listen) {
+    listenSocket = listen;
+    Wakeup();
+    return true;
+}
+
+void PollLoop::AddConnection(SOCKET clientSocket, const sockaddr_in& clientAddr) {
+    u_long mode = 1;
+    if (ioctlsocket(clientSocket, FIONBIO, &mode) == SOCKET_ERROR) {
+        std::cerr << "[设置非阻塞失败] 错误码: " << WSAGetLastError() << std::endl;
+        closesocket(clientSocket);
+        return;
+    }
+
+    Adopt(MakePooled<ClientContext>(clientSocket, clientAddr));
+}
+
+bool PollLoop::Adopt(const std::shared_ptr<ClientContext>& client) {
+    client->loop = this;
+    {
+        std::lock_guard<std::mutex> lk(pendingMutex);
+        pendingConnections.push_back(client);
+    }
+    connCount++;
+    Wakeup();
+    return true;
+}
+
+// 停止 I/O 线程但保留连接：之后处理线程的 Send 仍可把响应放入发送队列，随连接一起交接
+bool PollLoop::Detach(std::vector<std::shared_ptr<ClientContext>>& out) {
+    if (!isRunning.exchange(false)) return false;
+
+    listenSocket = INVALID_SOCKET;
+    Wakeup();
+    if (ioThread.joinable()) {
+        ioThread.join();
+    }
+    // I/O 线程已退出，此后 Send 不再发送唤醒信号
+    wakeupPending = true;
+
+    std::lock_guard<std::mutex> lk(pendingMutex);
+    for (auto* list : { &connections, &pendingConnections }) {
+        for (auto& client : *list) {
+            if (!client->closed) out.push_back(client);
+        }
+        list->clear();
+    }
+    resumedConnections.clear();
+    idleWheel.Clear();
+    connCount = 0;
+
+    closesocket(wakeupSocket);
+    wakeupSocket = INVALID_SOCKET;
+    return true;
+}
+
+void PollLoop::ResumeRead(const std::shared_ptr<ClientContext>& client) {
+    if (client->resumePosted.exchange(true)) return;
+    {
+        std::lock_guard<std::mutex> lk(pendingMutex);
+        resumedConnections.push_back(client);
+    }
+    Wakeup();
+}
+
+void PollLoop::Wakeup() {
+    // 已有未处理的唤醒信号时不重复发送
+    if (wakeupPending.exchange(true)) return;
+    char b = 0;
+    send(wakeupSocket, &b, 1, 0);
+}
+
+void PollLoop::DrainWakeup() {
+    wakeupPending = false;
+    char buf[64];
+    while (recv(wakeupSocket, buf, sizeof(buf), 0) > 0) {
+    }
+}
+
+void PollLoop::ApplyPendingConnections() {
+    std::lock_guard<std::mutex> lk(pendingMutex);
+    for (auto& client : pendingConnections) {
+        char clientIP[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &(client->clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
+        std::cout << "[客户端连接] IP: " << clientIP << ", 端口: " << ntohs(client->clientAddr.sin_port) << std::endl;
+        idleWheel.Add(client, GetTickCount64());
+        // 热升级接管的连接可能带有旧进程已收到、尚未处理的数据
+        if (client->decoder.Readable() > 0 && !DrainFrames(client)) {
+            CloseConnection(client);
+            continue;
+        }
+        connections.push_back(std::move(client));
+    }
+    pendingConnections.clear();
+}
+
+// 恢复读取：先分发暂停期间留在接收缓冲区中的帧，下一轮 poll 重新关注可读事件
+void PollLoop::ApplyResumedReads() {
+    std::vector<std::shared_ptr<ClientContext>> resumed;
+    {
+        std::lock_guard<std::mutex> lk(pendingMutex);
+        resumed.swap(resumedConnections);
+    }
+    for (auto& client : resumed) {
+        client->resumePosted = false;
+        if (client->closed) continue;
+        if (client->decoder.Readable() > 0 && !DrainFrames(client)) {
+            CloseConnection(client);
+        }
+    }
+}
+
+void PollLoop::Run() {
+    int pollErrors = 0;
+    while (isRunning && !g_shouldQuit) {
+        ApplyPendingConnections();
+        ApplyResumedReads();
+
+        // 每轮重建 poll 集合：0 号为唤醒 socket，开始接入后 1 号为监听 socket，其余与 connections 一一对应
+        SOCKET listen = listenSocket;
+        const std::size_t base = (listen != INVALID_SOCKET) ? 2 : 1;
+        pollFds.resize(connections.size() + base);
+        pollFds[0].fd = wakeupSocket;
+        pollFds[0].events = POLLRDNORM;
+        pollFds[0].revents = 0;
+        if (listen != INVALID_SOCKET) {
+            pollFds[1].fd = listen;
+            pollFds[1].events = POLLRDNORM;
+            pollFds[1].revents = 0;
+        }
+        for (std::size_t i = 0; i < connections.size(); ++i) {
+            WSAPOLLFD& pfd = pollFds[i + base];
+            pfd.fd = connections[i]->clientSocket;
+            // 读取暂停的连接不关注可读事件（错误和挂断仍会报告）
+            pfd.events = connections[i]->readPaused ? 0 : POLLRDNORM;
+            if (connections[i]->wantWrite) pfd.events |= POLLWRNORM;
+            pfd.revents = 0;
+        }
+
+        // 启用空闲检测时最多等到时间轮下一格
+        DWORD waitMs = idleWheel.NextTimeoutMs(GetTickCount64());
+        int ready = WSAPoll(pollFds.data(), static_cast<ULONG>(pollFds.size()),
+            waitMs == INFINITE ? -1 : static_cast<int>(waitMs));
+        ioCalls++;
+        if (ready == SOCKET_ERROR) {
+            int err = WSAGetLastError();
+            std::cerr << "[WSAPoll失败] 错误码: " << err << ", 连接数: " << connections.size() << std::endl;
+            bool giveUp = ++pollErrors > POLL_MAX_ERRORS;
+            if (!giveUp && (err == WSAENOBUFS || err == WSAEINTR || err == WSAEINPROGRESS)) {
+                // 暂时性错误：稍后重试
+                Sleep(POLL_RETRY_DELAY_MS);
+                continue;
+            }
+            // 其他错误（如集合中有已失效的 socket）无法定位到具体连接：关闭本分片的全部连接，客户端重连后重新接入
+            for (auto& client : connections) {
+                CloseConnection(client);
+            }
+            connections.clear();
+            {
+                std::lock_guard<std::mutex> lk(pendingMutex);
+                connCount = pendingConnections.size();
+            }
+            if (giveUp) {
+                std::cerr << "[WSAPoll失败] 连续失败超过 " << POLL_MAX_ERRORS << " 次，I/O 分片停止" << std::endl;
+                break;
+            }
+            continue;
+        }
+        pollErrors = 0;
+
+        if (pollFds[0].revents != 0) {
+            DrainWakeup();
+        }
+
+        for (std::size_t i = 0; i < connections.size(); ++i) {
+            const std::shared_ptr<ClientContext>& client = connections[i];
+            SHORT revents = pollFds[i + base].revents;
+            if (client->closed) continue;
+            if (client->sendOverflow) {
+                CloseConnection(client);
+                continue;
+            }
+            if (revents == 0) continue;
+
+            if (revents & (POLLERR | POLLNVAL)) {
+                HandleSocketError(client.get(), SOCKET_ERROR);
+                CloseConnection(client);
+                continue;
+            }
+            // 读取暂停期间对端已挂断：排队的请求的响应无处可发，直接关闭，避免 poll 反复报告挂断
+            if ((revents & POLLHUP) && client->readPaused) {
+                HandleSocketError(client.get(), 0);
+                CloseConnection(client);
+                continue;
+            }
+            // POLLHUP 时 recv 会返回 0，统一走读路径处理断开
+            if (revents & (POLLRDNORM | POLLHUP)) {
+                OnReadable(client);
+            }
+            if (!client->closed && (revents & POLLWRNORM)) {
+                FlushOutbound(client);
+            }
+        }
+
+        // 新连接在本轮处理完已有连接后再接入，下一轮加入 poll 集合
+        if (listen != INVALID_SOCKET) {
+            if (pollFds[1].revents & (POLLERR | POLLNVAL)) {
+                // 监听 socket 已关闭（退出流程中），不再接入
+                listenSocket = INVALID_SOCKET;
+            }
+            else if (pollFds[1].revents & POLLRDNORM) {
+                OnAcceptable();
+            }
+        }
+
+        CheckIdleConnections();
+
+        // 清理已关闭的连接
+        connections.erase(std::remove_if(connections.begin(), connections.end(),
+            [](const std::shared_ptr<ClientContext>& c) { return c->closed.load(); }),
+            connections.end());
+        std::lock_guard<std::mutex> lk(pendingMutex);
+        connCount = connections.size() + pendingConnections.size();
+    }
+}
+
+// 在共享监听 socket 上接入连接，接入的连接直接归本分片所有。
+// 多个分片同时被唤醒时只有一个能 accept 成功，其余得到 WSAEWOULDBLOCK。
+void PollLoop::OnAcceptable() {
+    for (int i = 0; i < MAX_ACCEPTS_PER_EVENT; ++i) {
+        sockaddr_in clientAddr;
+        int clientAddrLen = sizeof(clientAddr);
+        SOCKET clientSocket = accept(listenSocket, reinterpret_cast<sockaddr*>(&clientAddr), &clientAddrLen);
+        ioCalls++;
+        if (clientSocket == INVALID_SOCKET) {
+            int err = WSAGetLastError();
+            if (err != WSAEWOULDBLOCK && !g_shouldQuit) {
+                std::cerr << "[接受连接失败] 错误码: " << err << std::endl;
+            }
+            return;
+        }
+
+        u_long mode = 1;
+        if (!reactor->CanAccept() || ioctlsocket(clientSocket, FIONBIO, &mode) == SOCKET_ERROR) {
+            closesocket(clientSocket);
+            std::cerr << "[接受连接失败] 客户端连接被拒绝" << std::endl;
+            continue;
+        }
+
+        auto client = MakePooled<ClientContext>(clientSocket, clientAddr);
+        client->loop = this;
+        char clientIP[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &(clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
+        std::cout << "[客户端连接] IP: " << clientIP << ", 端口: " << ntohs(clientAddr.sin_port) << std::endl;
+        idleWheel.Add(client, GetTickCount64());
+        connections.push_back(std::move(client));
+        connCount++;
+    }
+}
+
+// 非阻塞读取：每次把 socket 中现有的数据尽量读满接收缓冲区，再取出其中所有完整的帧
+void PollLoop::OnReadable(const std::shared_ptr<ClientContext>& client) {
+    for (int reads = 0; reads < MAX_READS_PER_EVENT; ++reads) {
+        FrameSegment segments[2];
+        int count = client->decoder.WritableSegments(segments);
+
+        WSABUF bufs[2];
+        DWORD want = 0;
+        for (int i = 0; i < count; ++i) {
+            bufs[i].buf = segments[i].data;
+            bufs[i].len = static_cast<ULONG>(segments[i].len);
+            want += bufs[i].len;
+        }
+
+        DWORD bytesRead = 0;
+        DWORD flags = 0;
+        int rc = WSARecv(client->clientSocket, bufs, count, &bytesRead, &flags, NULL, NULL);
+        ioCalls++;
+        if (rc == SOCKET_ERROR) {
+            if (WSAGetLastError() == WSAEWOULDBLOCK) return;
+            HandleSocketError(client.get(), SOCKET_ERROR);
+            CloseConnection(client);
+            return;
+        }
+        if (bytesRead == 0) {
+            HandleSocketError(client.get(), 0);
+            CloseConnection(client);
+            return;
+        }
+
+        client->decoder.Commit(bytesRead);
+        client->lastActive = GetTickCount64();
+        bool paused = false;
+        if (!DrainFrames(client, &paused)) {
+            CloseConnection(client);
+            return;
+        }
+        if (paused) return;
+
+        // 没有读满说明 socket 已读空，无需再调用一次 recv 去确认 WSAEWOULDBLOCK
+        if (bytesRead < want) return;
+    }
+}
+
+// 发送响应：帧进入发送队列，由 I/O 线程发送。
+// 队列由空变为非空时才唤醒 I/O 线程，其后入队的帧（例如价格剧烈波动时的一串告警推送）
+// 会在同一次聚集写中发出；任意线程调用都只经 sendMutex 修改队列，不会相互踩写。
+bool PollLoop::SendFrame(ClientContext* client, std::string&& frame, SendPriority priority) {
+    if (!FinishFrame(client, frame)) return false;
+
+    {
+        std::lock_guard<std::mutex> lk(client->sendMutex);
+        if (client->closed) return false;
+        if (!EnqueueFrame(client, std::move(frame), priority)) {
+            // 慢消费者：唤醒 I/O 线程断开连接（对端不读取时 socket 不会变为可写）
+            Wakeup();
+            return false;
+        }
+    }
+    if (!client->wantWrite.exchange(true)) {
+        Wakeup();
+    }
+    return true;
+}
+
+// 用聚集写发送队列中的帧，直到队列为空或 socket 发送缓冲区已满
+void PollLoop::FlushOutbound(const std::shared_ptr<ClientContext>& client) {
+    std::lock_guard<std::mutex> lk(client->sendMutex);
+    while (!client->outbound.Empty()) {
+        WSABUF bufs[MAX_GATHER_BUFFERS];
+        int count = client->outbound.Gather(bufs, MAX_GATHER_BUFFERS);
+        DWORD sent = 0;
+        int rc = WSASend(client->clientSocket, bufs, count, &sent, 0, NULL, NULL);
+        ioCalls++;
+        if (rc == SOCKET_ERROR) {
+            if (WSAGetLastError() != WSAEWOULDBLOCK) {
+                std::cerr << "[发送失败] 错误码: " << WSAGetLastError() << std::endl;
+            }
+            return;
+        }
+        client->outbound.Consume(sent);
+    }
+    // 队列已空；其他线程随后入队时会重新置位并唤醒
+    client->wantWrite = false;
+}
+
+// 关闭连接（仅在 I/O 线程或停止时调用）
+void PollLoop::CloseConnection(const std::shared_ptr<ClientContext>& client) {
+    {
+        std::lock_guard<std::mutex> lk(client->sendMutex);
+        if (client->closed.exchange(true)) return;
+        closesocket(client->clientSocket);
+        client->outbound.Clear();
+    }
+    OnConnectionClosed(client);
+}
+
+// ==========================================
+// Reactor 类实现
+// ==========================================
+
+Reactor::Reactor(ThreadPool* handlerPool, IoBackend backend, int ioThreadCount)
+    : backend(backend), isRunning(false) {
+    // 默认每个 CPU 核一个分片
+    if (ioThreadCount <= 0) {
+        ioThreadCount = (std::max)(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+    for (int i = 0; i < ioThreadCount; ++i) {
+        if (backend == IoBackend::Iocp) {
+            loops.push_back(std::make_unique<IocpLoop>(handlerPool, this));
+        }
+        else {
+            loops.push_back(std::make_unique<PollLoop>(handlerPool, this));
+        }
+    }
+}
+
+Reactor::~Reactor() {
+    Stop();
+}
+
+bool Reactor::Start() {
+    if (isRunning) return true;
+    for (auto& loop : loops) {
+        if (!loop->Start()) {
+            Stop();
+            return false;
+        }
+    }
+    isRunning = true;
+    std::cout << "[I/O线程启动成功] 后端: " << IoBackendName(backend) << ", 线程数量: " << loops.size() << std::endl;
+    return true;
+}
+
+void Reactor::Stop() {
+    for (auto& loop : loops) {
+        loop->Stop();
+    }
+    if (isRunning) {
+        isRunning = false;
+
+        // 输出 I/O 统计，便于对比 poll 与 iocp 两种后端的系统调用开销
+        unsigned long long calls = 0, reqs = 0, evictions = 0;
+        unsigned long long reserved = 0, rejected = 0, slowConsumers = 0;
+        for (auto& loop : loops) {
+            calls += loop->IoCallCount();
+            reqs += loop->RequestCount();
+            evictions += loop->IdleEvictionCount();
+            reserved += loop->AlertReserveCount();
+            rejected += loop->RejectedFrameCount();
+            slowConsumers += loop->SlowConsumerCount();
+        }
+        std::cout << "[I/O线程已停止] 后端: " << IoBackendName(backend)
+            << ", I/O调用次数: " << calls << ", 请求数: " << reqs
+            << ", 空闲断开数: " << evictions << std::endl;
+        std::cout << "[发送队列] 告警使用保留额度: " << reserved << ", 拒绝帧数: " << rejected
+            << ", 慢消费者断开数: " << slowConsumers << std::endl;
+    }
+}
+
+bool Reactor::StartAccepting(SOCKET listenSocket) {
+    if (!isRunning) return false;
+
+    // 一个 socket 只能关联一个完成端口，完成端口后端由首个分片投递 AcceptEx
+    if (backend == IoBackend::Iocp) {
+        return loops.front()->StartAccepting(listenSocket);
+    }
+
+    for (auto& loop : loops) {
+        if (!loop->StartAccepting(listenSocket)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Reactor::SetIdleTimeout(int seconds) {
+    ULONGLONG timeoutMs = seconds > 0 ? static_cast<ULONGLONG>(seconds) * 1000 : 0;
+    for (auto& loop : loops) {
+        loop->SetIdleTimeout(timeoutMs);
+    }
+}
+
+bool Reactor::DetachAll(std::vector<std::shared_ptr<ClientContext>>& out) {
+    if (!isRunning || backend != IoBackend::Poll) return false;
+    for (auto& loop : loops) {
+        loop->Detach(out);
+    }
+    isRunning = false;
+    return true;
+}
+
+bool Reactor::AdoptConnection(const std::shared_ptr<ClientContext>& client) {
+    if (!isRunning || backend != IoBackend::Poll) return false;
+
+    EventLoop* target = loops.front().get();
+    for (auto& loop : loops) {
+        if (loop->ConnectionCount() < target->ConnectionCount()) {
+            target = loop.get();
+        }
+    }
+    return target->Adopt(client);
+}
+
+bool Reactor::CanAccept() const {
+    if (!isRunning || g_shouldQuit) return false;
+
+    if (ConnectionCount() >= MAX_CLIENT_COUNT) {
+        std::cerr << "[连接已满] 客户端数量已达上限 (" << MAX_CLIENT_COUNT << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Reactor::AddConnection(SOCKET clientSocket, const sockaddr_in& clientAddr) {
+    if (!CanAccept()) return false;
+
+    // 分配给当前连接数最少的事件循环
+    EventLoop* target = loops.front().get();
+    for (auto& loop : loops) {
+        if (loop->ConnectionCount() < target->ConnectionCount()) {
+            target = loop.get();
+        }
+    }
+    target->AddConnection(clientSocket, clientAddr);
+    return true;
+}
+
+std::size_t Reactor::ConnectionCount() const {
+    std::size_t total = 0;
+    for (auto& loop : loops) {
+        total += loop->ConnectionCount();
+    }
+    return total;
+}
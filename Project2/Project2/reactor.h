@@ -0,0 +1,209 @@
+﻿#pragma once
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include "thread_local.h"
+#include "timing_wheel.h"
+#include "json_writer.h"
+
+// I/O 线程配置
+const int IO_THREAD_COUNT = 0;          // I/O 分片数（每个分片一个线程），0 表示按 CPU 核数
+const int MAX_READS_PER_EVENT = 16;     // 单次可读事件最多调用 recv 的次数，避免单个客户端饿死其他连接
+const int MAX_ACCEPTS_PER_EVENT = 64;   // 监听 socket 单次可读事件最多接入的连接数
+const int IDLE_TIMEOUT_SECONDS = 90;    // 默认空闲超时：客户端每 30 秒发一次心跳，连续 3 次未收到任何数据即断开
+const int POLL_RETRY_DELAY_MS = 10;     // WSAPoll 暂时性失败（系统资源不足等）后重试的间隔
+const int POLL_MAX_ERRORS = 100;        // WSAPoll 连续失败超过该次数时分片停止，关闭其全部连接
+
+// 读取背压：每连接已解码、等待处理的请求超过上限时暂停读取该连接，
+// 处理线程消化到上限的一半以下再恢复，未读取的数据留在 socket 接收缓冲区，由 TCP 流控限制对端
+const std::size_t INBOX_MAX_BYTES = 4 * 1024 * 1024;
+const std::size_t INBOX_MAX_FRAMES = 256;
+
+// 前置声明
+class ThreadPool;
+class Reactor;
+
+// 网络后端，启动时通过命令行 --io=poll / --io=iocp 选择
+enum class IoBackend {
+    Poll,   // WSAPoll 就绪通知 + 非阻塞 recv/send
+    Iocp    // 完成端口：AcceptEx 预投递、每连接固定接收缓冲区、批量取完成事件
+};
+
+IoBackend ParseIoBackend(int argc, char* argv[]);
+const char* IoBackendName(IoBackend backend);
+
+// 解析命令行 --max-frame-bytes=N（v4 帧最大消息体长度），未指定时返回 0
+std::size_t ParseMaxFrameBytes(int argc, char* argv[]);
+
+// 解析命令行 --idle-timeout=秒（0 表示不检测空闲连接），未指定时返回 IDLE_TIMEOUT_SECONDS
+int ParseIdleTimeout(int argc, char* argv[]);
+
+// 事件循环基类：一个 I/O 线程负责其名下所有客户端 socket 的收发。
+// 读到完整消息后放入客户端 inbox 并交给处理线程池，自身从不执行业务逻辑，
+// 因此少量 I/O 线程即可承载成千上万个长连接。
+// 每个事件循环是一个独立分片：自己接入连接、持有自己的连接集合，分片之间不共享锁。
+class EventLoop {
+public:
+    EventLoop(ThreadPool* handlerPool, Reactor* reactor);
+    virtual ~EventLoop() = default;
+
+    virtual bool Start() = 0;
+    virtual void Stop() = 0;
+
+    // 开始在共享的监听 socket 上接入连接
+    virtual bool StartAccepting(SOCKET listenSocket) = 0;
+
+    // 以下接口可在任意线程调用
+    virtual void AddConnection(SOCKET clientSocket, const sockaddr_in& clientAddr) = 0;
+    // priority 为 Alert 的帧在发送队列中越过排队的普通响应
+    bool Send(ClientContext* client, const std::string& responseData,
+              SendPriority priority = SendPriority::Normal);
+    // 发送由 BeginFrame 开始、已直接写好消息体的帧：按连接当前的帧格式填写消息头后整体移入发送队列
+    virtual bool SendFrame(ClientContext* client, std::string&& frame,
+                           SendPriority priority = SendPriority::Normal) = 0;
+    std::size_t ConnectionCount() const { return connCount.load(); }
+
+    // 恢复读取暂停的连接（处理线程把 inbox 消化到上限的一半以下后调用，可在任意线程调用）
+    virtual void ResumeRead(const std::shared_ptr<ClientContext>& client) = 0;
+
+    // 热升级：停止收发但不关闭连接，把仍打开的连接交给调用方；不支持的后端返回 false
+    virtual bool Detach(std::vector<std::shared_ptr<ClientContext>>& out) { return false; }
+    // 热升级：接管从旧进程交接来的连接（会话状态、未发送的帧已恢复到 client 中）
+    virtual bool Adopt(const std::shared_ptr<ClientContext>& client) { return false; }
+
+    // 空闲超时（毫秒，0 表示不检测），需在 Start 之前设置
+    void SetIdleTimeout(ULONGLONG timeoutMs) { idleWheel.SetTimeout(timeoutMs); }
+
+    // I/O 统计（系统调用/完成事件次数与收到的消息数），用于对比不同后端
+    unsigned long long IoCallCount() const { return ioCalls.load(); }
+    unsigned long long RequestCount() const { return requests.load(); }
+    unsigned long long IdleEvictionCount() const { return idleEvictions.load(); }
+
+    // 慢消费者统计：使用告警保留额度入队的帧数、被拒绝的帧数、因发送队列超限断开的连接数
+    unsigned long long AlertReserveCount() const { return alertReserveFrames.load(); }
+    unsigned long long RejectedFrameCount() const { return rejectedFrames.load(); }
+    unsigned long long SlowConsumerCount() const { return slowConsumerDisconnects.load(); }
+
+protected:
+    virtual void CloseConnection(const std::shared_ptr<ClientContext>& client) = 0;
+    void CheckIdleConnections();
+
+    // 检查消息体长度并按连接当前的帧格式填写消息头
+    bool FinishFrame(ClientContext* client, std::string& frame);
+    // 帧入队并按慢消费者策略记录决策（调用方须持有 sendMutex）；
+    // 返回 false 表示帧被拒绝，首次超限时置位 sendOverflow，由后端安排 I/O 线程断开连接
+    bool EnqueueFrame(ClientContext* client, std::string&& frame, SendPriority priority);
+    // 取出并分发完整的帧；paused 非空时输出是否因读取背压而停止（剩余的帧留在接收缓冲区）
+    bool DrainFrames(const std::shared_ptr<ClientContext>& client, bool* paused = nullptr);
+    void DispatchRequest(const std::shared_ptr<ClientContext>& client, std::string&& body);
+    void OnConnectionClosed(const std::shared_ptr<ClientContext>& client);
+    void HandleSocketError(ClientContext* client, int bytesRead);
+
+    ThreadPool* handlerPool;
+    Reactor* reactor;
+    std::atomic<std::size_t> connCount;
+    std::atomic<unsigned long long> ioCalls;
+    std::atomic<unsigned long long> requests;
+    std::atomic<unsigned long long> idleEvictions;
+    std::atomic<unsigned long long> alertReserveFrames;
+    std::atomic<unsigned long long> rejectedFrames;
+    std::atomic<unsigned long long> slowConsumerDisconnects;
+
+    // 空闲检测时间轮（仅由 I/O 线程访问）
+    TimingWheel idleWheel;
+};
+
+// WSAPoll 事件循环：用 WSAPoll 多路复用非阻塞 socket。
+// 所有分片都把同一个非阻塞监听 socket 放进自己的 poll 集合，谁先 accept 到连接就归谁。
+class PollLoop : public EventLoop {
+public:
+    PollLoop(ThreadPool* handlerPool, Reactor* reactor);
+    ~PollLoop();
+
+    bool Start() override;
+    void Stop() override;
+    bool StartAccepting(SOCKET listenSocket) override;
+    void AddConnection(SOCKET clientSocket, const sockaddr_in& clientAddr) override;
+    bool SendFrame(ClientContext* client, std::string&& frame,
+                   SendPriority priority = SendPriority::Normal) override;
+    void ResumeRead(const std::shared_ptr<ClientContext>& client) override;
+    bool Detach(std::vector<std::shared_ptr<ClientContext>>& out) override;
+    bool Adopt(const std::shared_ptr<ClientContext>& client) override;
+
+private:
+    void Run();
+    void Wakeup();
+    void DrainWakeup();
+    void ApplyPendingConnections();
+    void ApplyResumedReads();
+    void OnAcceptable();
+    void OnReadable(const std::shared_ptr<ClientContext>& client);
+    void FlushOutbound(const std::shared_ptr<ClientContext>& client);
+    void CloseConnection(const std::shared_ptr<ClientContext>& client) override;
+
+    std::thread ioThread;
+    std::atomic<bool> isRunning;
+
+    // 唤醒 WSAPoll 用的本地 UDP socket（连接到自身）
+    SOCKET wakeupSocket;
+    std::atomic<bool> wakeupPending;
+
+    // 共享的监听 socket（未开始接入时为 INVALID_SOCKET）
+    std::atomic<SOCKET> listenSocket;
+
+    // 其他线程投递的新连接与恢复读取的连接
+    std::mutex pendingMutex;
+    std::vector<std::shared_ptr<ClientContext>> pendingConnections;
+    std::vector<std::shared_ptr<ClientContext>> resumedConnections;
+
+    // 仅由 I/O 线程访问
+    std::vector<std::shared_ptr<ClientContext>> connections;
+    std::vector<WSAPOLLFD> pollFds;
+};
+
+// 反应器：持有若干 I/O 分片（默认每核一个），由分片自己在共享监听 socket 上接入连接
+class Reactor {
+public:
+    Reactor(ThreadPool* handlerPool, IoBackend backend = IoBackend::Poll, int ioThreadCount = IO_THREAD_COUNT);
+    ~Reactor();
+
+    bool Start();
+    void Stop();
+
+    // 让各分片开始接入连接，主线程无需阻塞在 accept 上
+    bool StartAccepting(SOCKET listenSocket);
+
+    // 设置各分片的空闲超时（秒，0 表示不检测），需在 Start 之前调用
+    void SetIdleTimeout(int seconds);
+
+    // 接管一个已 accept 的 socket：分配给连接数最少的事件循环
+    bool AddConnection(SOCKET clientSocket, const sockaddr_in& clientAddr);
+
+    // 热升级（仅 poll 后端）：停止所有分片并取出仍打开的连接 / 接管旧进程交接来的连接。
+    // 交接失败时可再次 Start、StartAccepting 并用 AdoptConnection 重新接管取出的连接
+    bool DetachAll(std::vector<std::shared_ptr<ClientContext>>& out);
+    bool AdoptConnection(const std::shared_ptr<ClientContext>& client);
+
+    // 分片接入新连接前检查是否允许接入（运行中且未超过最大连接数）
+    bool CanAccept() const;
+
+    std::size_t ConnectionCount() const;
+    std::size_t LoopCount() const { return loops.size(); }
+    IoBackend Backend() const { return backend; }
+
+private:
+    std::vector<std::unique_ptr<EventLoop>> loops;
+    IoBackend backend;
+    bool isRunning;
+};
+
+extern Reactor* g_pReactor;
+
+#endif // REACTOR_H
@@ -0,0 +1,154 @@
+﻿#include "request_job.h"
+
+namespace {
+
+std::size_t SkipSpaces(const std::string& s, std::size_t i) {
+    while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r' || s[i] == '\n')) ++i;
+    return i;
+}
+
+// 读取 s[i] 开始的 bytes 字节大端无符号整数，i 移到其后
+bool ReadBigEndian(const std::string& s, std::size_t& i, int bytes, uint64_t& value) {
+    if (i + bytes > s.size()) return false;
+    value = 0;
+    for (int k = 0; k < bytes; ++k) value = (value << 8) | static_cast<unsigned char>(s[i + k]);
+    i += bytes;
+    return true;
+}
+
+// 读取一个 MessagePack 值的头部：字符串给出长度，map/array 给出需要继续跳过的元素个数，
+// 其余标量给出负载长度。i 移到头部之后
+bool ReadMsgpackHead(const std::string& s, std::size_t& i, bool& isString, uint64_t& payload, uint64_t& children) {
+    if (i >= s.size()) return false;
+    unsigned char c = static_cast<unsigned char>(s[i++]);
+    isString = false;
+    payload = 0;
+    children = 0;
+    if (c <= 0x7f || c >= 0xe0 || c == 0xc0 || c == 0xc2 || c == 0xc3) return true;
+    if (c <= 0x8f) { children = 2ull * (c & 0x0f); return true; }
+    if (c <= 0x9f) { children = c & 0x0f; return true; }
+    if (c <= 0xbf) { isString = true; payload = c & 0x1f; return true; }
+
+    uint64_t n = 0;
+    switch (c) {
+    case 0xc4: case 0xd9: isString = c == 0xd9; return ReadBigEndian(s, i, 1, payload);
+    case 0xc5: case 0xda: isString = c == 0xda; return ReadBigEndian(s, i, 2, payload);
+    case 0xc6: case 0xdb: isString = c == 0xdb; return ReadBigEndian(s, i, 4, payload);
+    case 0xc7: if (!ReadBigEndian(s, i, 1, payload)) return false; payload += 1; return true;
+    case 0xc8: if (!ReadBigEndian(s, i, 2, payload)) return false; payload += 1; return true;
+    case 0xc9: if (!ReadBigEndian(s, i, 4, payload)) return false; payload += 1; return true;
+    case 0xca: payload = 4; return true;
+    case 0xcb: payload = 8; return true;
+    case 0xcc: case 0xd0: payload = 1; return true;
+    case 0xcd: case 0xd1: payload = 2; return true;
+    case 0xce: case 0xd2: payload = 4; return true;
+    case 0xcf: case 0xd3: payload = 8; return true;
+    case 0xd4: payload = 2; return true;
+    case 0xd5: payload = 3; return true;
+    case 0xd6: payload = 5; return true;
+    case 0xd7: payload = 9; return true;
+    case 0xd8: payload = 17; return true;
+    case 0xdc: if (!ReadBigEndian(s, i, 2, n)) return false; children = n; return true;
+    case 0xdd: if (!ReadBigEndian(s, i, 4, n)) return false; children = n; return true;
+    case 0xde: if (!ReadBigEndian(s, i, 2, n)) return false; children = 2 * n; return true;
+    case 0xdf: if (!ReadBigEndian(s, i, 4, n)) return false; children = 2 * n; return true;
+    default: return false;  // 0xc1 未使用
+    }
+}
+
+// MessagePack 请求体：逐个检查顶层 map 的键，其余值（含嵌套容器）按头部长度跳过，不解码。
+// 键重复时与 DOM 解析一致取最后一个
+std::string_view PeekMsgpackString(const std::string& body, std::string_view key) {
+    std::size_t i = 0;
+    bool isString;
+    uint64_t payload, pairs;
+    if (!ReadMsgpackHead(body, i, isString, payload, pairs)) return {};
+
+    std::string_view found;
+    for (uint64_t k = 0; k < pairs / 2; ++k) {
+        uint64_t children;
+        if (!ReadMsgpackHead(body, i, isString, payload, children) || payload > body.size() - i) return {};
+        bool isKey = isString && std::string_view(body.data() + i, payload) == key;
+        i += payload;
+
+        if (!ReadMsgpackHead(body, i, isString, payload, children) || payload > body.size() - i) return {};
+        if (isKey) {
+            found = isString ? std::string_view(body.data() + i, payload) : std::string_view();
+        }
+        i += payload;
+
+        // 跳过嵌套容器中的全部元素
+        while (children > 0) {
+            uint64_t more;
+            if (!ReadMsgpackHead(body, i, isString, payload, more) || payload > body.size() - i) return {};
+            i += payload;
+            children += more - 1;
+        }
+    }
+    return found;
+}
+
+// 顶层对象中名为 key 的字符串字段的值（JSON 或 MessagePack），找不到、不是字符串或含转义字符时返回空。
+// 键重复时与 DOM 解析一致取最后一个，否则分类用的 type 可能与实际分发的不同
+std::string_view PeekTopLevelString(const std::string& body, std::string_view key) {
+    if (ChatMessage::is_msgpack_body(body.data(), body.size())) {
+        return PeekMsgpackString(body, key);
+    }
+
+    const std::size_t n = body.size();
+    int depth = 0;
+    std::size_t i = 0;
+    std::string_view found;
+    while (i < n) {
+        char c = body[i];
+        if (c == '"') {
+            // 跳过整个字符串（含转义），字符串里的括号不计入层级
+            std::size_t start = ++i;
+            while (i < n && body[i] != '"') i += (body[i] == '\\') ? 2 : 1;
+            if (i >= n) break;
+            std::string_view token(body.data() + start, i - start);
+            ++i;
+
+            // 只关心顶层对象中的键
+            if (depth != 1 || token != key) continue;
+            std::size_t j = SkipSpaces(body, i);
+            if (j >= n || body[j] != ':') continue;   // 是值而不是键
+            j = SkipSpaces(body, j + 1);
+            found = {};
+            if (j >= n || body[j] != '"') continue;
+
+            std::size_t valueStart = ++j;
+            while (j < n && body[j] != '"' && body[j] != '\\') ++j;
+            // 合法的请求类型不含转义字符；值本身由外层循环照常跳过
+            if (j < n && body[j] == '"') {
+                found = std::string_view(body.data() + valueStart, j - valueStart);
+            }
+            continue;
+        }
+        if (c == '{' || c == '[') ++depth;
+        else if (c == '}' || c == ']') --depth;
+        ++i;
+    }
+    return found;
+}
+
+} // namespace
+
+std::string_view PeekRequestType(const std::string& body) {
+    return PeekTopLevelString(body, "type");
+}
+
+std::string_view PeekRequestId(const std::string& body) {
+    return PeekTopLevelString(body, "request_id");
+}
+
+RequestLane ClassifyRequest(const std::string& body) {
+    switch (LookupRequestType(PeekRequestType(body))) {
+    case RequestType::QueryWarnings:
+    case RequestType::AlertAck:
+    case RequestType::Heartbeat:
+        return RequestLane::Parallel;
+    default:
+        return RequestLane::Ordered;
+    }
+}
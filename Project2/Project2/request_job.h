@@ -0,0 +1,46 @@
+﻿#pragma once
+#ifndef REQUEST_JOB_H
+#define REQUEST_JOB_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include "thread_local.h"
+#include "request_types.h"
+
+// 请求在处理线程池中的执行通道
+enum class RequestLane {
+    Ordered,    // 登录、注册、增删改预警等会改变会话或数据的请求：同一连接内按到达顺序串行执行
+    Parallel    // 只读查询、告警确认与心跳：可与同一连接的其他请求并行执行，响应按 request_id 匹配
+};
+
+// I/O 线程解码出完整帧后投递给处理线程池的任务
+// Ordered 任务不携带 body，表示“继续处理该客户端 inbox 中的有序请求”；
+// Parallel 任务携带单条请求，执行完直接把响应放入连接的发送队列。
+// 这样一条慢查询不会挡住同一连接后续的请求（无队头阻塞的流水线）。
+struct RequestJob {
+    std::shared_ptr<ClientContext> client;
+    std::string body;
+    RequestLane lane;
+
+    RequestJob() : lane(RequestLane::Ordered) {}
+    RequestJob(std::shared_ptr<ClientContext> c, std::string&& b, RequestLane l)
+        : client(std::move(c)), body(std::move(b)), lane(l) {
+    }
+};
+
+// 不做完整 JSON 解析，只扫描出顶层 "type" 字段的值（MessagePack 请求体按其格式扫描）；找不到时返回空
+// 返回值指向 body 内部，body 修改或释放后失效
+std::string_view PeekRequestType(const std::string& body);
+
+// 同上，扫描顶层 "request_id" 字段的值（用于日志，不含转义字符的 ID 才能取到）
+std::string_view PeekRequestId(const std::string& body);
+
+// 根据请求类型选择执行通道，无法识别的请求一律走有序通道
+RequestLane ClassifyRequest(const std::string& body);
+
+// 有序通道中的请求改为异步完成（如预警单写入的组提交）时，处理线程不等待结果，
+// 该连接的有序通道保持 scheduled 暂停；完成方发出响应后调用此函数继续处理 inbox 中的后续请求
+void ResumeOrderedLane(const std::shared_ptr<ClientContext>& client);
+
+#endif // REQUEST_JOB_H
@@ -0,0 +1,70 @@
+﻿#include "request_parser.h"
+
+bool FieldValue::AsString(std::string& out) const {
+    if (kind != Kind::String) return false;
+    out.assign(str.data(), str.size());
+    return true;
+}
+
+bool FieldValue::AsDouble(double& out) const {
+    if (kind == Kind::Float) { out = number; return true; }
+    if (kind == Kind::Integer) { out = static_cast<double>(integer); return true; }
+    return false;
+}
+
+bool FieldValue::AsInt64(long long& out) const {
+    if (kind == Kind::Integer) { out = integer; return true; }
+    if (kind != Kind::String || str.empty() || str.size() > 18) return false;
+
+    long long value = 0;
+    for (char c : str) {
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + (c - '0');
+    }
+    out = value;
+    return true;
+}
+
+bool RequestBase::SetCommonField(std::string_view key, const FieldValue& v) {
+    if (key == "request_id") {
+        if (!v.AsString(requestId)) MarkBad(key);
+        return true;
+    }
+    return false;
+}
+
+void AddWarningRequest::SetField(std::string_view key, const FieldValue& v) {
+    if (SetCommonField(key, v)) return;
+
+    bool ok = true;
+    if (key == "account") ok = v.AsString(account);
+    else if (key == "username") { if (account.empty()) ok = v.AsString(account); }
+    else if (key == "symbol") ok = v.AsString(symbol);
+    else if (key == "warning_type") ok = v.AsString(warningType);
+    else if (key == "max_price") ok = hasMaxPrice = v.AsDouble(maxPrice);
+    else if (key == "min_price") ok = hasMinPrice = v.AsDouble(minPrice);
+    else if (key == "trigger_time") ok = hasTriggerTime = v.AsString(triggerTime);
+    if (!ok) MarkBad(key);
+}
+
+void ModifyWarningRequest::SetField(std::string_view key, const FieldValue& v) {
+    if (SetCommonField(key, v)) return;
+
+    bool ok = true;
+    if (key == "order_id") ok = hasOrderId = v.AsInt64(orderId);
+    else if (key == "warning_type") ok = v.AsString(warningType);
+    else if (key == "max_price") ok = hasMaxPrice = v.AsDouble(maxPrice);
+    else if (key == "min_price") ok = hasMinPrice = v.AsDouble(minPrice);
+    else if (key == "trigger_time") ok = hasTriggerTime = v.AsString(triggerTime);
+    if (!ok) MarkBad(key);
+}
+
+void DeleteWarningRequest::SetField(std::string_view key, const FieldValue& v) {
+    if (SetCommonField(key, v)) return;
+    if (key == "order_id" && !(hasOrderId = v.AsInt64(orderId))) MarkBad(key);
+}
+
+void AlertAckRequest::SetField(std::string_view key, const FieldValue& v) {
+    if (SetCommonField(key, v)) return;
+    if (key == "order_id" && !(hasOrderId = v.AsInt64(orderId))) MarkBad(key);
+}
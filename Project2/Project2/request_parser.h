@@ -0,0 +1,208 @@
+﻿#pragma once
+#ifndef REQUEST_PARSER_H
+#define REQUEST_PARSER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include "nlohmann/json.hpp"
+#include "base.h"
+
+using json = nlohmann::json;
+
+// 请求顶层字段的标量值（字符串只引用解析器内部缓冲区，仅在 SetField 调用期间有效）
+struct FieldValue {
+    enum class Kind { String, Integer, Float, Bool, Null };
+
+    Kind kind = Kind::Null;
+    std::string_view str;
+    long long integer = 0;
+    double number = 0;
+    bool boolean = false;
+
+    bool AsString(std::string& out) const;
+    bool AsDouble(double& out) const;       // 整数或浮点数
+    bool AsInt64(long long& out) const;     // 整数或纯数字字符串（客户端的 order_id 以字符串发送）
+};
+
+// 类型化请求的公共字段
+struct RequestBase {
+    std::string requestId;
+    std::string badField;   // 类型不符的字段名，非空时按 1003 拒绝
+
+    // 处理公共字段，返回 true 表示已识别
+    bool SetCommonField(std::string_view key, const FieldValue& v);
+    void MarkBad(std::string_view key) { if (badField.empty()) badField = key; }
+};
+
+struct AddWarningRequest : RequestBase {
+    std::string account;
+    std::string symbol;
+    std::string warningType = "price";
+    bool hasMaxPrice = false;
+    bool hasMinPrice = false;
+    bool hasTriggerTime = false;
+    double maxPrice = 0;
+    double minPrice = 0;
+    std::string triggerTime;
+
+    void SetField(std::string_view key, const FieldValue& v);
+};
+
+struct ModifyWarningRequest : RequestBase {
+    bool hasOrderId = false;
+    long long orderId = 0;
+    std::string warningType = "price";
+    bool hasMaxPrice = false;
+    bool hasMinPrice = false;
+    bool hasTriggerTime = false;
+    double maxPrice = 0;
+    double minPrice = 0;
+    std::string triggerTime;
+
+    void SetField(std::string_view key, const FieldValue& v);
+};
+
+struct DeleteWarningRequest : RequestBase {
+    bool hasOrderId = false;
+    long long orderId = 0;
+
+    void SetField(std::string_view key, const FieldValue& v);
+};
+
+struct AlertAckRequest : RequestBase {
+    bool hasOrderId = false;
+    long long orderId = 0;
+
+    void SetField(std::string_view key, const FieldValue& v);
+};
+
+struct HeartbeatRequest : RequestBase {
+    void SetField(std::string_view key, const FieldValue& v) { SetCommonField(key, v); }
+};
+
+// SAX 事件处理器：只把顶层对象的标量字段交给 target.SetField，嵌套的对象/数组整体跳过。
+// 不构造 DOM，语法错误通过返回值报告，不抛异常
+template <class Target>
+class RequestSax {
+public:
+    explicit RequestSax(Target& target) : target(target), depth(0) {}
+
+    bool null() { return Scalar(FieldValue()); }
+    bool boolean(bool val) {
+        FieldValue v;
+        v.kind = FieldValue::Kind::Bool;
+        v.boolean = val;
+        return Scalar(v);
+    }
+    bool number_integer(json::number_integer_t val) {
+        FieldValue v;
+        v.kind = FieldValue::Kind::Integer;
+        v.integer = val;
+        return Scalar(v);
+    }
+    bool number_unsigned(json::number_unsigned_t val) {
+        FieldValue v;
+        v.kind = FieldValue::Kind::Integer;
+        v.integer = static_cast<long long>(val);
+        return Scalar(v);
+    }
+    bool number_float(json::number_float_t val, const json::string_t&) {
+        FieldValue v;
+        v.kind = FieldValue::Kind::Float;
+        v.number = val;
+        return Scalar(v);
+    }
+    bool string(json::string_t& val) {
+        FieldValue v;
+        v.kind = FieldValue::Kind::String;
+        v.str = val;
+        return Scalar(v);
+    }
+    bool binary(json::binary_t&) { return true; }
+
+    bool start_object(std::size_t) {
+        // 请求体本身必须是对象
+        if (depth == 0 && started) return false;
+        started = true;
+        ++depth;
+        return true;
+    }
+    bool end_object() { --depth; return true; }
+    bool start_array(std::size_t) {
+        if (depth == 0) return false;
+        ++depth;
+        return true;
+    }
+    bool end_array() { --depth; return true; }
+    bool key(json::string_t& val) {
+        if (depth == 1) currentKey = val;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) { return false; }
+
+private:
+    bool Scalar(const FieldValue& v) {
+        if (depth == 0) return false;   // 顶层不是对象
+        if (depth == 1) target.SetField(currentKey, v);
+        return true;
+    }
+
+    Target& target;
+    int depth;
+    bool started = false;
+    std::string currentKey;
+};
+
+// 把请求体（JSON 文本或 MessagePack）直接解析为类型化请求，语法错误或顶层不是对象时返回 false
+template <class Target>
+bool ParseRequest(const std::string& body, Target& target) {
+    RequestSax<Target> sax(target);
+    json::input_format_t format = ChatMessage::is_msgpack_body(body.data(), body.size())
+        ? json::input_format_t::msgpack : json::input_format_t::json;
+    return json::sax_parse(body, &sax, format, true, false);
+}
+
+// 从已解析的 DOM 填充类型化请求（batch 子请求、DOM 路径使用）
+template <class Target>
+void FillRequest(const json& request, Target& target) {
+    if (!request.is_object()) return;
+    for (auto it = request.begin(); it != request.end(); ++it) {
+        const json& value = it.value();
+        FieldValue v;
+        switch (value.type()) {
+        case json::value_t::string:
+            v.kind = FieldValue::Kind::String;
+            v.str = value.get_ref<const std::string&>();
+            break;
+        case json::value_t::number_integer:
+        case json::value_t::number_unsigned:
+            v.kind = FieldValue::Kind::Integer;
+            v.integer = value.get<long long>();
+            break;
+        case json::value_t::number_float:
+            v.kind = FieldValue::Kind::Float;
+            v.number = value.get<double>();
+            break;
+        case json::value_t::boolean:
+            v.kind = FieldValue::Kind::Bool;
+            v.boolean = value.get<bool>();
+            break;
+        case json::value_t::null:
+            break;
+        default:
+            continue;   // 嵌套对象/数组不属于这些请求的字段
+        }
+        target.SetField(it.key(), v);
+    }
+}
+
+template <class Target>
+Target FromJson(const json& request) {
+    Target target;
+    FillRequest(request, target);
+    return target;
+}
+
+#endif // REQUEST_PARSER_H
@@ -0,0 +1,110 @@
+﻿#pragma once
+#ifndef REQUEST_TYPES_H
+#define REQUEST_TYPES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// 协议中的全部请求类型，在此处集中声明一次。
+// 新增消息类型：在枚举和 REQUEST_TYPE_NAMES 中各加一项，再在 FuturesAlertServer::dispatch
+// 的 switch 中加一个分支（漏掉分支时编译器会对未处理的枚举值给出警告）
+enum class RequestType : std::uint8_t {
+    Register,
+    Login,
+    SetEmail,
+    AddWarning,
+    DeleteWarning,
+    ModifyWarning,
+    QueryWarnings,
+    AlertAck,
+    Heartbeat,
+    Batch,
+    Unknown
+};
+
+struct RequestTypeName {
+    std::string_view name;
+    RequestType type;
+};
+
+constexpr RequestTypeName REQUEST_TYPE_NAMES[] = {
+    { "register", RequestType::Register },
+    { "login", RequestType::Login },
+    { "set_email", RequestType::SetEmail },
+    { "add_warning", RequestType::AddWarning },
+    { "delete_warning", RequestType::DeleteWarning },
+    { "modify_warning", RequestType::ModifyWarning },
+    { "query_warnings", RequestType::QueryWarnings },
+    { "alert_ack", RequestType::AlertAck },
+    { "heartbeat", RequestType::Heartbeat },
+    { "batch", RequestType::Batch },
+};
+
+namespace request_types_detail {
+
+// 完美哈希表的槽数（2 的幂，取模即按位与）
+constexpr std::size_t TABLE_SIZE = 32;
+
+// 带种子的 FNV-1a
+constexpr std::uint32_t Hash(std::string_view s, std::uint32_t seed) {
+    std::uint32_t h = 2166136261u ^ seed;
+    for (char c : s) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+constexpr bool IsPerfect(std::uint32_t seed) {
+    bool used[TABLE_SIZE] = {};
+    for (const auto& entry : REQUEST_TYPE_NAMES) {
+        std::size_t slot = Hash(entry.name, seed) & (TABLE_SIZE - 1);
+        if (used[slot]) return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+// 编译期搜索一个使所有类型名互不冲突的种子
+constexpr std::uint32_t FindSeed() {
+    for (std::uint32_t seed = 0; seed < 100000; ++seed) {
+        if (IsPerfect(seed)) return seed;
+    }
+    return UINT32_MAX;
+}
+
+constexpr std::uint32_t SEED = FindSeed();
+static_assert(SEED != UINT32_MAX, "请求类型名找不到无冲突的哈希种子，请增大 TABLE_SIZE");
+
+struct Table {
+    RequestTypeName slots[TABLE_SIZE];
+};
+
+constexpr Table BuildTable() {
+    Table table{};
+    for (auto& slot : table.slots) {
+        slot = { std::string_view(), RequestType::Unknown };
+    }
+    for (const auto& entry : REQUEST_TYPE_NAMES) {
+        table.slots[Hash(entry.name, SEED) & (TABLE_SIZE - 1)] = entry;
+    }
+    return table;
+}
+
+constexpr Table TABLE = BuildTable();
+
+} // namespace request_types_detail
+
+// 类型名 -> 请求类型：一次哈希加一次字符串比较，未知类型返回 RequestType::Unknown
+constexpr RequestType LookupRequestType(std::string_view name) {
+    using namespace request_types_detail;
+    const RequestTypeName& slot = TABLE.slots[Hash(name, SEED) & (TABLE_SIZE - 1)];
+    return slot.name == name ? slot.type : RequestType::Unknown;
+}
+
+static_assert(LookupRequestType("add_warning") == RequestType::AddWarning, "请求类型哈希表构造错误");
+static_assert(LookupRequestType("batch") == RequestType::Batch, "请求类型哈希表构造错误");
+static_assert(LookupRequestType("") == RequestType::Unknown, "请求类型哈希表构造错误");
+
+#endif // REQUEST_TYPES_H
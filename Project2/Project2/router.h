@@ -3,6 +3,7 @@
 #define ROUTER_H
 #include <string>
 #include "handler.h"
+#include "request_job.h"
 #include "nlohmann/json.hpp"
 
 using json = nlohmann::json;
@@ -34,42 +35,45 @@ private:
 public:
     RequestRouter() = default;
 
-    // 路由请求并返回响应
-    std::string RouteRequest(const std::string& requestData) {
-        try {
-            // 解析JSON请求
-            json request = json::parse(requestData);
+    // 路由请求，响应直接写入 frame（由 BeginFrame 开始，之后交给 EventLoop::SendFrame）。
+    // 请求体可以是 JSON 文本或 MessagePack（按首字节区分），响应按连接协商的编码写出。
+    // 解析失败不抛异常；处理过程中的异常已由 FuturesAlertServer::routeRequest 统一转换为错误响应，这里不再包一层。
+    // allowDeferred 为 true（有序通道）时预警单的新增与修改异步写入，返回 false 表示响应稍后发出、frame 不发送
+    bool RouteRequest(const std::string& requestData, std::string& frame, bool allowDeferred = false) {
+        RequestType type = LookupRequestType(PeekRequestType(requestData));
+        if (allowDeferred && server.routeDeferred(type, requestData)) {
+            return false;
+        }
 
-            // 路由到对应的处理函数
-            json response = server.routeRequest(request);
+        BeginFrame(frame);
 
-            // 转换为字符串返回（容错：如果字符串中包含非 UTF-8，使用 replace 策略）
-            return response.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+        // 热点请求直接解析为请求结构体，不构造 DOM
+        if (server.routeTyped(type, requestData, frame)) {
+            return true;
         }
-        catch (const json::parse_error& e) {
+
+        // 解析JSON请求
+        json request = ChatMessage::is_msgpack_body(requestData.data(), requestData.size())
+            ? json::from_msgpack(requestData, true, false)
+            : json::parse(requestData, nullptr, false);
+        if (request.is_discarded()) {
             // 处理JSON解析错误 - error_code 1002
-            json errorResp = {
-                {"type", "response"},
-                {"request_id", ""},
-                {"request_type", ""},
-                {"status", 1},
-                {"error_code", 1002},
-                {"data", { {"hint", std::string("JSON解析错误: ") + e.what()} }}
-            };
-            return errorResp.dump();
-        }
-        catch (const std::exception& e) {
-            // 处理其他异常 - error_code 1001
-            json errorResp = {
-                {"type", "response"},
-                {"request_id", ""},
-                {"request_type", ""},
-                {"status", 1},
-                {"error_code", 1001},
-                {"data", { {"hint", std::string("处理请求时出错: ") + e.what()} }}
-            };
-            return errorResp.dump();
+            JsonWriter(frame, FuturesAlertServer::responseEncoding()).BeginObject()
+                .Field("type", "response")
+                .Field("request_id", "")
+                .Field("request_type", "")
+                .Field("status", 1)
+                .Field("error_code", 1002)
+                .Key("data").BeginObject().Field("hint", "JSON解析错误").EndObject()
+                .EndObject();
+            return true;
         }
+
+        // 路由到对应的处理函数，序列化直接追加到帧中（容错：如果字符串中包含非 UTF-8，使用 replace 策略）。
+        // 编码在处理之后读取：登录响应本身就使用协商后的编码
+        json response = server.routeRequest(request);
+        AppendJson(frame, response, FuturesAlertServer::responseEncoding());
+        return true;
     }
 };
 #endif
\ No newline at end of file
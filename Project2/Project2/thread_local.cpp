@@ -1,6 +1,4 @@
 #include "thread_local.h"
 #define WIN32_LEAN_AND_MEAN
 // ʼֲ߳̾ .cpp ļж壬ᱨӴ
-thread_local std::string ThreadLocalUser::s_user_id = "";
-thread_local std::string ThreadLocalUser::s_user_token = "";
-ClientContext* ThreadLocalUser::s_client = NULL;
\ No newline at end of file
+thread_local ClientContext* ThreadLocalUser::s_client = NULL;
\ No newline at end of file
@@ -9,77 +9,128 @@
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <string>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
 #include "base.h"
+#include "frame_decoder.h"
+#include "outbound_queue.h"
+
+class EventLoop;
+
 // ͻĽṹ
-struct ClientContext {
+//  I/O ̣߳EventLoop socket Ķдֻ߳ͨ inbox / SendResponse ֮
+struct ClientContext : public std::enable_shared_from_this<ClientContext> {
     SOCKET clientSocket;
     sockaddr_in clientAddr;
-    ChatMessage readMsg;
-    ChatMessage writeMsg;
+    EventLoop* loop;
+
+    // ջ֡״̬ I/O ̷߳ʣ
+    FrameDecoder decoder;
+    std::atomic<ULONGLONG> lastActive;  // һյݵʱ䣨GetTickCount64ڿм
+
+    // ÿͻ˵֡ʽChatMessage::frame_v3 / frame_v4¼ʱЭ
+    std::atomic<int> frameVersion;
+    // ÿͻ˵Ϣ루ChatMessage::body_json / body_msgpack¼ʱЭ
+    std::atomic<int> bodyEncoding;
+    // ¼ʱЭֵ̣֡ѹ
+    std::atomic<bool> compressFrames;
+    // ѵ¼¼֮ǰֻС֡ PREAUTH_MAX_BODY_LENGTH
+    std::atomic<bool> authenticated;
+
+    // ѽ롢ȴִ߳е
+    std::mutex inboxMutex;
+    std::deque<std::string> inbox;
+    std::size_t inboxBytes;         // inbox ֽ inboxMutex 
+    bool scheduled;                 // Ƿڴ̳߳ض
+    std::atomic<bool> readPaused;   // inbox ޣI/O ߳ͣȡ߳һºָ
+    std::atomic<bool> resumePosted; //  I/O ָ̻߳ȡδִ
+    std::atomic<int> parallelInflight;  // ڲִͨе
+
+    // Ự״̬ԭڴ̵ֲ߳߳̾У
+    std::mutex sessionMutex;
+    std::string userId;
+    std::string userToken;
+
+    // ͵֡Ӧ澯Ͷﾭ I/O ̺߳ϲ
+    std::mutex sendMutex;
+    OutboundQueue outbound;
+    std::atomic<bool> wantWrite;    // ͶзǿգҪ I/O ̷߳
+    std::atomic<bool> sendOverflow; // Ͷгޣߣ I/O ̶߳Ͽ
+    std::atomic<bool> closed;
 
     ClientContext(SOCKET sock, const sockaddr_in& addr)
-        : clientSocket(sock), clientAddr(addr) {
+        : clientSocket(sock), clientAddr(addr), loop(nullptr), lastActive(GetTickCount64()),
+          frameVersion(ChatMessage::frame_v3), bodyEncoding(ChatMessage::body_json), compressFrames(false), authenticated(false), inboxBytes(0), scheduled(false), readPaused(false), resumePosted(false), parallelInflight(0), wantWrite(false), sendOverflow(false), closed(false) {
     }
 };
 
 
-// ֲ߳̾洢û IDÿ̶߳һݣ
+// ֲ߳̾洢ǰĿͻˣÿ̶߳һݣ
+// û ID / token ڿͻУͬһӵɲִͬ߳
 class ThreadLocalUser {
 public:
     // õǰ̵߳û ID
     static void SetUserID(std::string user_id) {
-        s_user_id = user_id;
+        if (s_client == NULL) return;
+        std::lock_guard<std::mutex> lk(s_client->sessionMutex);
+        s_client->userId = user_id;
     }
 
-    
 
-    // ȡǰ̵߳û IDĬϷ 0 ʾδã
+
+    // ȡǰ̵߳û IDĬϷؿձʾδã
     static std::string GetUserID() {
-        return s_user_id;
+        if (s_client == NULL) return "";
+        std::lock_guard<std::mutex> lk(s_client->sessionMutex);
+        return s_client->userId;
     }
 
     // յǰ̵߳û IDû˳¼
     static void ClearUserID() {
-        s_user_id = "";
+        SetUserID("");
     }
 
 
-    // ȡǰ̵߳û IDĬϷ 0 ʾδã
+    // ȡǰ̵߳û tokenĬϷؿձʾδã
     static std::string GetUserToken() {
-        return s_user_token;
+        if (s_client == NULL) return "";
+        std::lock_guard<std::mutex> lk(s_client->sessionMutex);
+        return s_client->userToken;
     }
 
-    // յǰ̵߳û IDû˳¼
+    // յǰ̵߳û tokenû˳¼
     static void ClearUserToken() {
-        s_user_token = "";
+        SetUserToken("");
     }
 
-    // õǰ̵߳û ID
+    // õǰ̵߳û token
     static void SetUserToken(std::string user_token) {
-        s_user_token = user_token;
+        if (s_client == NULL) return;
+        std::lock_guard<std::mutex> lk(s_client->sessionMutex);
+        s_client->userToken = user_token;
     }
 
-    // õǰ̵߳û ID
+    // õǰ߳ڴĿͻ
     static void SetClient(ClientContext* client) {
         s_client = client;
     }
 
-    // ȡǰ̵߳û IDĬϷ 0 ʾδã
+    // ȡǰ߳ڴĿͻˣδ÷ NULL
     static ClientContext* GetClient() {
         return s_client;
     }
 
-    // յǰ̵߳û IDû˳¼
+    // յǰ߳ڴĿͻ
     static void ClearClient() {
         s_client = NULL;
     }
 
-    
+
 private:
-    // thread_local ؼ֣ÿ߳ж s_user_id ʵ
-    static thread_local std::string s_user_id;
-	static thread_local std::string s_user_token;
-	static ClientContext* s_client;
+    // thread_local ؼ֣ÿ߳ж s_client ʵ
+	static thread_local ClientContext* s_client;
 };
 
 
@@ -3,6 +3,20 @@ bool g_shouldQuit = false;
 SOCKET g_listenSocket = INVALID_SOCKET;
 ThreadPool *g_pThreadPool = nullptr;
 
+void ResumeOrderedLane(const std::shared_ptr<ClientContext>& client)
+{
+    ThreadPool* pool = g_pThreadPool;
+    if (pool != nullptr)
+    {
+        pool->ResumeClient(client);
+        return;
+    }
+    std::lock_guard<std::mutex> lk(client->inboxMutex);
+    client->inbox.clear();
+    client->inboxBytes = 0;
+    client->scheduled = false;
+}
+
 // 控制台控制处理函数
 BOOL WINAPI ConsoleCtrlHandler(DWORD dwCtrlType)
 {
@@ -17,6 +31,11 @@ BOOL WINAPI ConsoleCtrlHandler(DWORD dwCtrlType)
             g_listenSocket = INVALID_SOCKET;
         }
 
+        if (g_pReactor != nullptr)
+        {
+            g_pReactor->Stop();
+        }
+
         if (g_pThreadPool != nullptr)
         {
             g_pThreadPool->Stop();
@@ -138,13 +157,23 @@ SOCKET CreateListenSocket()
         return INVALID_SOCKET;
     }
 
-    if (listen(listenSocket, 5) == SOCKET_ERROR)
+    // 重连高峰（如 CTP 断线恢复后所有客户端同时重连）时 backlog 过小会直接拒绝连接
+    if (listen(listenSocket, LISTEN_BACKLOG) == SOCKET_ERROR)
     {
         std::cerr << "[监听失败] 错误码: " << WSAGetLastError() << std::endl;
         closesocket(listenSocket);
         return INVALID_SOCKET;
     }
 
+    // 多个 I/O 分片共享同一个监听 socket，必须为非阻塞，未抢到连接的分片立即返回
+    u_long mode = 1;
+    if (ioctlsocket(listenSocket, FIONBIO, &mode) == SOCKET_ERROR)
+    {
+        std::cerr << "[设置非阻塞失败] 错误码: " << WSAGetLastError() << std::endl;
+        closesocket(listenSocket);
+        return INVALID_SOCKET;
+    }
+
     std::cout << "[监听启动成功] IP: " << listenIp << " 端口: " << LISTEN_PORT << " (等待客户端连接...)" << std::endl;
     return listenSocket;
 }
\ No newline at end of file
@@ -5,7 +5,6 @@
 
 #include <iostream>
 #include <vector>
-#include <queue>
 #include <string>
 #include <windows.h>
 #include <winsock2.h>
@@ -14,6 +13,9 @@
 #include "handler.h"
 #include "router.h"
 #include "thread_local.h"
+#include "reactor.h"
+#include "request_job.h"
+#include "executor.h"
 
 #include <thread>
 #include <memory>
@@ -23,9 +25,13 @@
 
 extern bool g_shouldQuit;
 // 线程池配置
-const int THREAD_POOL_SIZE = 4;
-const int MAX_CLIENT_COUNT = 100;
+const int THREAD_POOL_SIZE = 4;          // 请求处理线程数
+const int MAX_CLIENT_COUNT = 10000;      // 最大连接数（由 Reactor 检查）
+const int MAX_REQUESTS_PER_TURN = 16;    // 处理线程每轮为同一客户端处理的最大请求数
+const int MAX_PARALLEL_REQUESTS_PER_CLIENT = 4;  // 同一客户端同时在并行通道中执行的最大请求数，超出的排入有序通道
 const int LISTEN_PORT = 8888;
+const int LISTEN_BACKLOG = SOMAXCONN;      // 监听队列长度，使用系统允许的最大值
+const std::size_t REQUEST_LOG_FIELD_MAX = 64;   // 请求日志中 type / request_id 的最大输出长度
 
 // 前置声明
 class RequestRouter;
@@ -42,242 +48,156 @@ struct ClientContext {
     }
 };
 */
-// 线程池类
+// 线程池类：请求处理线程池
+// socket 的收发由 Reactor 的 I/O 线程负责，这里只处理 I/O 线程投递的 RequestJob，
+// 处理结果放入所属连接的发送队列，由 I/O 线程写出。
+// 任务运行在工作窃取执行器上，告警通知、数据库回写等后台任务也共用这些线程
 class ThreadPool {
 private:
-    std::vector<HANDLE> workerThreads;
-    std::queue<ClientContext*> taskQueue;
-    CRITICAL_SECTION cs;
-    HANDLE hTaskEvent;
-    bool isRunning;
-    int clientCount;
+    WorkStealingExecutor executor;
     RequestRouter* router ;  // 路由实例指针
 
-    static DWORD WINAPI WorkerThreadProc(LPVOID lpParam) {
-        ThreadPool* pPool = static_cast<ThreadPool*>(lpParam);
-        pPool->ProcessTasks();
-        return 0;
-    }
-
-    void ProcessTasks() {
-        while (isRunning && !g_shouldQuit) {
-            DWORD waitResult = WaitForSingleObject(hTaskEvent, 100);
-            if (waitResult == WAIT_OBJECT_0) {
-                while (isRunning && !g_shouldQuit) {
-                    ClientContext* client = nullptr;
-                    EnterCriticalSection(&cs);
-                    if (!taskQueue.empty()) {
-                        client = taskQueue.front();
-                        taskQueue.pop();
-                    }
-                    else {
-                        ResetEvent(hTaskEvent);
-                    }
-                    LeaveCriticalSection(&cs);
-
-                    if (client == nullptr) break;
-
-                    HandleClient(client);
-                    delete client;
-
-                    EnterCriticalSection(&cs);
-                    clientCount--;
-                    LeaveCriticalSection(&cs);
-                }
-            }
-            else if (waitResult == WAIT_TIMEOUT) {
-                continue;
-            }
-            else {
-                break;
-            }
+    void RunJob(RequestJob& job) {
+        if (job.lane == RequestLane::Parallel) {
+            HandleRequest(job);
+        }
+        else {
+            HandleClient(job.client);
         }
     }
 
-    // 处理客户端连接
-    void HandleClient(ClientContext* client) {
+    // 处理客户端的待处理请求
+    // 同一客户端同时只会被一个处理线程执行，保证请求按到达顺序处理；
+    // 每轮最多处理 MAX_REQUESTS_PER_TURN 条，剩余的重新排队，避免单个客户端长期占用线程
+    void HandleClient(const std::shared_ptr<ClientContext>& client) {
         char clientIP[INET_ADDRSTRLEN];
         inet_ntop(AF_INET, &(client->clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
         uint16_t clientPort = ntohs(client->clientAddr.sin_port);
 
-        std::cout << "[客户端连接] IP: " << clientIP << ", 端口: " << clientPort << std::endl;
-		ThreadLocalUser::SetClient(client);
-        while (isRunning && !g_shouldQuit) {
-            // 读取消息头
-            int bytesRead = recv(client->clientSocket,
-                client->readMsg.data(),
-                client->readMsg.header_length,
-                0);
-
-            if (bytesRead <= 0) {
-                HandleSocketError(clientIP, clientPort, bytesRead);
-                break;
+        ThreadLocalUser::SetClient(client.get());
+        for (int handled = 0; ; ++handled) {
+            std::string requestData;
+            bool resumeRead = false;
+            {
+                std::lock_guard<std::mutex> lk(client->inboxMutex);
+                if (client->inbox.empty() || client->closed) {
+                    client->inbox.clear();
+                    client->inboxBytes = 0;
+                    client->scheduled = false;
+                    break;
+                }
+                if (handled >= MAX_REQUESTS_PER_TURN) {
+                    // 保持 scheduled 标记，直接重新排队
+                    if (!AddTask(RequestJob(client, std::string(), RequestLane::Ordered))) {
+                        client->inbox.clear();
+                        client->inboxBytes = 0;
+                        client->scheduled = false;
+                    }
+                    break;
+                }
+                requestData = std::move(client->inbox.front());
+                client->inbox.pop_front();
+                client->inboxBytes -= requestData.size();
+                // 读取已暂停且 inbox 消化到上限的一半以下时恢复读取
+                if (client->readPaused && client->inbox.size() <= INBOX_MAX_FRAMES / 2 &&
+                    client->inboxBytes <= INBOX_MAX_BYTES / 2) {
+                    client->readPaused = false;
+                    resumeRead = true;
+                }
             }
-
-            // 解析消息头获取消息体长度
-            if (!client->readMsg.decode_header()) {
-                std::cerr << "[协议错误] 无效的消息头" << std::endl;
-                break;
+            if (resumeRead) {
+                client->loop->ResumeRead(client);
             }
 
-            // 读取消息体
-            bytesRead = recv(client->clientSocket,
-                client->readMsg.body(),
-                client->readMsg.body_length(),
-                0);
-
-            if (bytesRead <= 0) {
-                HandleSocketError(clientIP, clientPort, bytesRead);
-                break;
+            // 处理请求。日志只记录类型、request_id 与长度：请求体含 token、账号等字段，且可能很大
+            std::cout << "[接收请求] " << clientIP << ":" << clientPort
+                << " type=" << PeekRequestType(requestData).substr(0, REQUEST_LOG_FIELD_MAX)
+                << " request_id=" << PeekRequestId(requestData).substr(0, REQUEST_LOG_FIELD_MAX)
+                << " 长度=" << requestData.size() << std::endl;
+
+            // 路由请求，响应直接写入发送帧
+            std::string frame;
+            if (!router->RouteRequest(requestData, frame, true)) {
+                // 异步完成的请求：保持 scheduled，由完成方调用 ResumeOrderedLane 继续处理后续请求
+                ThreadLocalUser::ClearClient();
+                return;
             }
 
-            // 处理请求
-            std::string requestData(client->readMsg.body(), client->readMsg.body_length());
-            std::cout << "[接收数据] " << clientIP << ":" << clientPort << ": " << requestData << std::endl;
-
-            // 路由请求并获取响应
-			
-            std::string responseData = router->RouteRequest(requestData);
-
             // 发送响应
-            if (!SendResponse(client, responseData)) {
+            if (!SendResponse(client.get(), std::move(frame))) {
                 std::cerr << "[发送失败] " << clientIP << ":" << clientPort << std::endl;
-                break;
             }
         }
-        FuturesAlertServer::stopUserWatcher(ThreadLocalUser::GetUserToken() );
-        closesocket(client->clientSocket);
-
-        std::cout << "[连接关闭] IP: " << clientIP << ", 端口: " << clientPort << std::endl;
+        ThreadLocalUser::ClearClient();
     }
 
-    // 处理Socket错误
-    void HandleSocketError(const std::string& ip, uint16_t port, int bytesRead) {
-        if (bytesRead == 0) {
-            std::cout << "[客户端断开] IP: " << ip << ", 端口: " << port << std::endl;
-        }
-        else {
-            int err = WSAGetLastError();
-            if (err != WSAEWOULDBLOCK) {
-                std::cerr << "[接收错误] 客户端 " << ip << ":" << port
-                    << " 错误码: " << err << std::endl;
+    // 执行并行通道中的单条请求，不等待同一客户端的其他请求
+    void HandleRequest(RequestJob& job) {
+        ClientContext* client = job.client.get();
+        if (!client->closed) {
+            ThreadLocalUser::SetClient(client);
+            std::string frame;
+            router->RouteRequest(job.body, frame);
+            ThreadLocalUser::ClearClient();
+
+            if (!SendResponse(client, std::move(frame))) {
+                char clientIP[INET_ADDRSTRLEN];
+                inet_ntop(AF_INET, &(client->clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
+                std::cerr << "[发送失败] " << clientIP << ":" << ntohs(client->clientAddr.sin_port) << std::endl;
             }
         }
+        client->parallelInflight--;
     }
 
-    // 发送响应给客户端
-    bool SendResponse(ClientContext* client, const std::string& responseData) {
-        // 检查响应长度
-        if (responseData.size() > client->writeMsg.max_body_length) {
-            std::cerr << "[响应过长] 超过最大长度: " << client->writeMsg.max_body_length << std::endl;
-            return false;
-        }
-
-        // 填充响应数据
-        client->writeMsg.body_length(responseData.size());
-        std::memcpy(client->writeMsg.body(), responseData.data(), responseData.size());
-        client->writeMsg.encode_header();
-
-        // 发送数据
-        int totalSent = 0;
-        int dataLength = client->writeMsg.length();
-        const char* data = client->writeMsg.data();
-
-        while (totalSent < dataLength) {
-            int sent = send(client->clientSocket, data + totalSent, dataLength - totalSent, 0);
-            if (sent == SOCKET_ERROR) {
-                return false;
-            }
-            totalSent += sent;
-        }
-
-        return true;
+    // 发送响应帧给客户端（帧整体移入发送队列，由客户端所属的 I/O 线程负责后续写出）
+    bool SendResponse(ClientContext* client, std::string&& frame) {
+        return client->loop->SendFrame(client, std::move(frame));
     }
 
 public:
     ThreadPool(RequestRouter* routerInstance)
-        : isRunning(false), clientCount(0), router(routerInstance) {
-        InitializeCriticalSection(&cs);
-        hTaskEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+        : executor(THREAD_POOL_SIZE), router(routerInstance) {
     }
 
     ~ThreadPool() {
         Stop();
-        DeleteCriticalSection(&cs);
-        CloseHandle(hTaskEvent);
     }
 
     bool Start() {
-        if (isRunning) return true;
-        isRunning = true;
-        clientCount = 0;
-
-        for (int i = 0; i < THREAD_POOL_SIZE; ++i) {
-            HANDLE hThread = CreateThread(
-                NULL,
-                0,
-                WorkerThreadProc,
-                this,
-                0,
-                NULL
-            );
-            if (hThread == NULL) {
-                std::cerr << "[线程创建失败] 错误码: " << GetLastError() << std::endl;
-                Stop();
-                return false;
-            }
-            workerThreads.push_back(hThread);
-        }
+        if (executor.IsRunning()) return true;
+        if (!executor.Start()) return false;
+        g_pExecutor = &executor;
 
-        std::cout << "[线程池启动成功] 线程数量: " << THREAD_POOL_SIZE << std::endl;
+        std::cout << "[线程池启动成功] 线程数量: " << executor.WorkerCount() << std::endl;
         return true;
     }
 
+    // 连接由 Reactor 负责关闭，已关闭连接的请求在执行时直接丢弃
     void Stop() {
-        if (!isRunning) return;
-        isRunning = false;
-
-        SetEvent(hTaskEvent);
-
-        WaitForMultipleObjects(
-            static_cast<DWORD>(workerThreads.size()),
-            workerThreads.data(),
-            TRUE,
-            INFINITE
-        );
-
-        for (HANDLE hThread : workerThreads) {
-            CloseHandle(hThread);
-        }
-        workerThreads.clear();
-
-        EnterCriticalSection(&cs);
-        while (!taskQueue.empty()) {
-            ClientContext* client = taskQueue.front();
-            taskQueue.pop();
-            closesocket(client->clientSocket);
-            delete client;
+        if (!executor.IsRunning()) return;
+        if (g_pExecutor == &executor) {
+            g_pExecutor = nullptr;
         }
-        LeaveCriticalSection(&cs);
+        executor.Stop();
 
         std::cout << "[线程池已停止]" << std::endl;
     }
 
-    bool AddTask(ClientContext* client) {
-        if (!isRunning || client == nullptr || g_shouldQuit) return false;
+    // 继续处理因异步完成的请求而暂停的有序通道
+    void ResumeClient(const std::shared_ptr<ClientContext>& client) {
+        if (AddTask(RequestJob(client, std::string(), RequestLane::Ordered))) return;
+        std::lock_guard<std::mutex> lk(client->inboxMutex);
+        client->inbox.clear();
+        client->inboxBytes = 0;
+        client->scheduled = false;
+    }
 
-        EnterCriticalSection(&cs);
-        if (clientCount >= MAX_CLIENT_COUNT) {
-            LeaveCriticalSection(&cs);
-            std::cerr << "[连接已满] 客户端数量已达上限 (" << MAX_CLIENT_COUNT << ")" << std::endl;
-            return false;
-        }
-        taskQueue.push(client);
-        clientCount++;
-        SetEvent(hTaskEvent);
-        LeaveCriticalSection(&cs);
+    bool AddTask(RequestJob&& job) {
+        if (!executor.IsRunning() || job.client == nullptr || g_shouldQuit) return false;
 
-        return true;
+        return executor.Submit([this, job = std::move(job)]() mutable {
+            RunJob(job);
+        });
     }
 };
 
@@ -0,0 +1,69 @@
+﻿#include "timing_wheel.h"
+
+TimingWheel::TimingWheel()
+    : slots(TIMING_WHEEL_SLOTS), cursor(0), cursorTime(0), timeout(0) {
+}
+
+void TimingWheel::SetTimeout(ULONGLONG timeoutMs) {
+    timeout = timeoutMs;
+}
+
+void TimingWheel::Clear() {
+    for (auto& slot : slots) {
+        slot.clear();
+    }
+    cursorTime = 0;
+}
+
+void TimingWheel::Add(const std::shared_ptr<ClientContext>& client, ULONGLONG now) {
+    if (!Enabled()) return;
+    if (cursorTime == 0) cursorTime = now;
+    Schedule(std::weak_ptr<ClientContext>(client), client->lastActive + timeout);
+}
+
+// 按截止时间放入槽；超过一圈的先放在最远的槽，到期时再重新计算
+void TimingWheel::Schedule(std::weak_ptr<ClientContext>&& client, ULONGLONG deadline) {
+    ULONGLONG ticks = 1;
+    if (deadline > cursorTime) {
+        ticks = (deadline - cursorTime + TIMING_WHEEL_TICK_MS - 1) / TIMING_WHEEL_TICK_MS;
+        if (ticks == 0) ticks = 1;
+        if (ticks >= TIMING_WHEEL_SLOTS) ticks = TIMING_WHEEL_SLOTS - 1;
+    }
+    slots[(cursor + ticks) % TIMING_WHEEL_SLOTS].push_back(std::move(client));
+}
+
+void TimingWheel::Advance(ULONGLONG now, std::vector<std::shared_ptr<ClientContext>>& expired) {
+    if (!Enabled() || cursorTime == 0) return;
+
+    // 最多转一圈：长时间未推进时每个槽都已检查过一次，剩余的时间直接跳过
+    std::vector<std::weak_ptr<ClientContext>> due;
+    for (std::size_t n = 0; cursorTime + TIMING_WHEEL_TICK_MS <= now && n < TIMING_WHEEL_SLOTS; ++n) {
+        cursor = (cursor + 1) % TIMING_WHEEL_SLOTS;
+        cursorTime += TIMING_WHEEL_TICK_MS;
+
+        due.clear();
+        due.swap(slots[cursor]);
+        for (auto& entry : due) {
+            std::shared_ptr<ClientContext> client = entry.lock();
+            if (client == nullptr || client->closed) continue;
+
+            ULONGLONG deadline = client->lastActive + timeout;
+            if (deadline <= now) {
+                expired.push_back(std::move(client));
+            }
+            else {
+                Schedule(std::move(entry), deadline);
+            }
+        }
+    }
+    if (cursorTime + TIMING_WHEEL_TICK_MS <= now) {
+        cursorTime = now;
+    }
+}
+
+DWORD TimingWheel::NextTimeoutMs(ULONGLONG now) const {
+    if (!Enabled()) return INFINITE;
+    if (cursorTime == 0) return static_cast<DWORD>(TIMING_WHEEL_TICK_MS);
+    ULONGLONG next = cursorTime + TIMING_WHEEL_TICK_MS;
+    return next > now ? static_cast<DWORD>(next - now) : 0;
+}
@@ -0,0 +1,46 @@
+﻿#pragma once
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <memory>
+#include <vector>
+#include "thread_local.h"
+
+// 空闲检测时间轮配置
+const ULONGLONG TIMING_WHEEL_TICK_MS = 1000;    // 每格时长
+const std::size_t TIMING_WHEEL_SLOTS = 128;     // 槽数，一圈覆盖默认空闲超时，更长的超时到期时重新放入
+
+// 哈希时间轮：找出长时间没有收到任何数据的连接。
+// 每个 I/O 线程一个，只由所属线程访问，不加锁。
+// 收到数据时只更新 ClientContext::lastActive（O(1)，不移动时间轮中的条目）；
+// 条目所在槽到期时再比较最后活跃时间，仍活跃的按新的截止时间重新放入对应槽。
+class TimingWheel {
+public:
+    TimingWheel();
+
+    // 空闲超时（毫秒），0 表示不检测
+    void SetTimeout(ULONGLONG timeoutMs);
+    bool Enabled() const { return timeout > 0; }
+
+    // 连接加入时间轮（接入时调用一次）
+    void Add(const std::shared_ptr<ClientContext>& client, ULONGLONG now);
+
+    // 移除全部条目（热升级交出连接后调用，交接失败时连接可能被重新分配给其他 I/O 线程）
+    void Clear();
+
+    // 推进到 now，输出空闲超时的连接；已关闭或已释放的连接顺带移除
+    void Advance(ULONGLONG now, std::vector<std::shared_ptr<ClientContext>>& expired);
+
+    // 距下一格到期的毫秒数，作为 WSAPoll / GetQueuedCompletionStatusEx 的超时；未启用时返回 INFINITE
+    DWORD NextTimeoutMs(ULONGLONG now) const;
+
+private:
+    void Schedule(std::weak_ptr<ClientContext>&& client, ULONGLONG deadline);
+
+    std::vector<std::vector<std::weak_ptr<ClientContext>>> slots;
+    std::size_t cursor;         // 当前槽
+    ULONGLONG cursorTime;       // 当前槽对应的时间
+    ULONGLONG timeout;
+};
+
+#endif // TIMING_WHEEL_H
@@ -17,15 +17,12 @@ bool UserRegister(const string& username, const string& password, const string&
         return false;
     }
 
-    // 2. ȡ
-    Connection* conn = db_manager->GetConnection();
-    if (conn == nullptr) {
-        cerr << "ȡݿʧ" << endl;
-        return false;
-    }
-
     PreparedStatement* pstmt = nullptr;
+    // 2. ӳؽӣ뿪ʱԶ黹
+    ConnectionLease conn;
     try {
+        conn = db_manager->Acquire();
+
         // 3. ִвSQLԤ䣬ע룩
         const string insert_sql = "INSERT INTO `user` (username, password, email) VALUES (?, ?, ?)";
         pstmt = conn->prepareStatement(insert_sql);
@@ -44,6 +41,7 @@ bool UserRegister(const string& username, const string& password, const string&
         }
     }
     catch (const sql::SQLException& e) {
+        conn.InvalidateOnConnectionError();
         cerr << "עSQL쳣" << e.what()
             << " (룺" << e.getErrorCode() << ")" << endl;
         return false;
@@ -55,19 +53,17 @@ bool UserRegister(const string& username, const string& password, const string&
     //finally{
     //    // 4. ͷԴ˳򣺽ӣ
     //    if (pstmt != nullptr) delete pstmt;
-    //    db_manager->ReleaseConnection(conn); // 黹/ͷ
     //}
 }
 
 // ʾ2ûѯûѯݣ
 bool QueryUserByUsername(const string& username) {
     DBManager* db_manager = DBManager::GetInstance();
-    Connection* conn = db_manager->GetConnection();
-    if (conn == nullptr) return false;
-
     PreparedStatement* pstmt = nullptr;
     ResultSet* res = nullptr;
+    ConnectionLease conn;
     try {
+        conn = db_manager->Acquire();
         const string select_sql = "SELECT id, username, email, create_time FROM `user` WHERE username = ?";
         pstmt = conn->prepareStatement(select_sql);
         pstmt->setString(1, username);
@@ -87,12 +83,12 @@ bool QueryUserByUsername(const string& username) {
         }
     }
     catch (const sql::SQLException& e) {
+        conn.InvalidateOnConnectionError();
         cerr << "ѯSQL쳣" << e.what() << endl;
         return false;
     }
    /* finally {
         if (res != nullptr) delete res;
         if (pstmt != nullptr) delete pstmt;
-        db_manager->ReleaseConnection(conn);
     }*/
 }
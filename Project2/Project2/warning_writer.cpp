@@ -0,0 +1,323 @@
+﻿#include "warning_writer.h"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <jdbc/cppconn/resultset.h>
+#include "executor.h"
+
+namespace {
+
+const char* const INSERT_WARNING_PREFIX =
+    "INSERT INTO alert_order(account, symbol, max_price, min_price, trigger_time, state) VALUES ";
+
+// 服务器的自增值分配方式（见 InsertWarnings）
+struct AutoIncrementMode {
+    bool loaded = false;
+    bool consecutive = false;   // 单条多行 INSERT 的自增值连续
+    long long step = 1;         // auto_increment_increment
+};
+
+std::mutex g_autoIncrementMutex;
+AutoIncrementMode g_autoIncrement;
+
+AutoIncrementMode GetAutoIncrementMode(ConnectionLease& conn) {
+    std::lock_guard<std::mutex> lk(g_autoIncrementMutex);
+    if (!g_autoIncrement.loaded) {
+        PreparedStatement* stmt = conn.Prepare(
+            "SELECT @@auto_increment_increment AS step, @@innodb_autoinc_lock_mode AS lock_mode");
+        std::unique_ptr<ResultSet> res(stmt->executeQuery());
+        if (res->next()) {
+            g_autoIncrement.step = res->getInt64("step");
+            g_autoIncrement.consecutive = res->getInt("lock_mode") <= 1 && g_autoIncrement.step >= 1;
+        }
+        g_autoIncrement.loaded = true;
+    }
+    return g_autoIncrement;
+}
+
+void BindWarning(PreparedStatement* stmt, unsigned int& col, const NewWarning& w) {
+    stmt->setString(col++, w.account);
+    stmt->setString(col++, w.symbol);
+    if (w.isTime) {
+        stmt->setNull(col++, DataType::DOUBLE);
+        stmt->setNull(col++, DataType::DOUBLE);
+        stmt->setString(col++, w.triggerTime);
+    }
+    else {
+        stmt->setDouble(col++, w.maxPrice);
+        stmt->setDouble(col++, w.minPrice);
+        stmt->setNull(col++, DataType::VARCHAR);
+    }
+}
+
+long long LastInsertId(ConnectionLease& conn) {
+    PreparedStatement* stmt = conn.Prepare("SELECT LAST_INSERT_ID() AS id");
+    std::unique_ptr<ResultSet> res(stmt->executeQuery());
+    res->next();
+    return res->getInt64("id");
+}
+
+} // namespace
+
+long long InsertWarning(ConnectionLease& conn, const NewWarning& warning) {
+    PreparedStatement* stmt = conn.Prepare(std::string(INSERT_WARNING_PREFIX) + "(?, ?, ?, ?, ?, 0)");
+    unsigned int col = 1;
+    BindWarning(stmt, col, warning);
+    stmt->execute();
+
+    // 获取刚插入的ID
+    return LastInsertId(conn);
+}
+
+std::vector<long long> InsertWarnings(ConnectionLease& conn, const std::vector<NewWarning>& rows) {
+    std::vector<long long> ids;
+    ids.reserve(rows.size());
+    if (rows.size() > 1 && !GetAutoIncrementMode(conn).consecutive) {
+        for (const auto& w : rows) {
+            ids.push_back(InsertWarning(conn, w));
+        }
+        return ids;
+    }
+    if (rows.size() == 1) {
+        ids.push_back(InsertWarning(conn, rows[0]));
+        return ids;
+    }
+
+    // 行数不固定的多行插入单独 prepare，不进连接的语句缓存
+    std::string sqlText = INSERT_WARNING_PREFIX;
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        sqlText += (i == 0) ? "(?, ?, ?, ?, ?, 0)" : ", (?, ?, ?, ?, ?, 0)";
+    }
+    std::unique_ptr<PreparedStatement> stmt(conn->prepareStatement(sqlText));
+    unsigned int col = 1;
+    for (const auto& w : rows) {
+        BindWarning(stmt.get(), col, w);
+    }
+    stmt->execute();
+
+    // 多行插入时 LAST_INSERT_ID 为第一行的 ID
+    long long firstId = LastInsertId(conn);
+    long long step = GetAutoIncrementMode(conn).step;
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        ids.push_back(firstId + static_cast<long long>(i) * step);
+    }
+    return ids;
+}
+
+void UpdateWarnings(ConnectionLease& conn, const std::vector<WarningChange>& changes) {
+    if (changes.empty()) return;
+
+    if (changes.size() == 1) {
+        // 单条修改：SQL 文本只取决于修改了哪些字段，使用连接上缓存的语句
+        const WarningChange& c = changes[0];
+        std::string sqlText = "UPDATE alert_order SET ";
+        const char* sep = "";
+        if (c.hasMaxPrice) { sqlText += sep; sqlText += "max_price=?"; sep = ", "; }
+        if (c.hasMinPrice) { sqlText += sep; sqlText += "min_price=?"; sep = ", "; }
+        if (c.hasTriggerTime) { sqlText += sep; sqlText += "trigger_time=?"; sep = ", "; }
+        if (*sep == '\0') return;
+        sqlText += " WHERE orderId=?";
+
+        PreparedStatement* stmt = conn.Prepare(sqlText);
+        unsigned int col = 1;
+        if (c.hasMaxPrice) stmt->setDouble(col++, c.maxPrice);
+        if (c.hasMinPrice) stmt->setDouble(col++, c.minPrice);
+        if (c.hasTriggerTime) stmt->setString(col++, c.triggerTime);
+        stmt->setInt64(col++, c.orderId);
+        stmt->execute();
+        return;
+    }
+
+    // 同一 orderId 的修改合并为一条（CASE 只取第一个匹配的 WHEN）
+    std::vector<WarningChange> merged;
+    std::unordered_map<long long, std::size_t> index;
+    for (const auto& c : changes) {
+        auto it = index.find(c.orderId);
+        if (it == index.end()) {
+            index.emplace(c.orderId, merged.size());
+            merged.push_back(c);
+            continue;
+        }
+        WarningChange& m = merged[it->second];
+        if (c.hasMaxPrice) { m.hasMaxPrice = true; m.maxPrice = c.maxPrice; }
+        if (c.hasMinPrice) { m.hasMinPrice = true; m.minPrice = c.minPrice; }
+        if (c.hasTriggerTime) { m.hasTriggerTime = true; m.triggerTime = c.triggerTime; }
+    }
+
+    // UPDATE alert_order SET max_price = CASE orderId WHEN ? THEN ? ... ELSE max_price END, ...
+    // WHERE orderId IN (?, ...)；没有任何修改涉及的字段不出现在 SET 中
+    auto appendCase = [&](std::string& sqlText, const char* column, bool WarningChange::* has) {
+        std::size_t count = 0;
+        for (const auto& m : merged) {
+            if (m.*has) ++count;
+        }
+        if (count == 0) return false;
+        sqlText += column;
+        sqlText += " = CASE orderId";
+        for (std::size_t i = 0; i < count; ++i) {
+            sqlText += " WHEN ? THEN ?";
+        }
+        sqlText += " ELSE ";
+        sqlText += column;
+        sqlText += " END";
+        return true;
+    };
+    std::string sqlText = "UPDATE alert_order SET ";
+    bool anyMax = appendCase(sqlText, "max_price", &WarningChange::hasMaxPrice);
+    if (anyMax) sqlText += ", ";
+    bool anyMin = appendCase(sqlText, "min_price", &WarningChange::hasMinPrice);
+    if (anyMin) sqlText += ", ";
+    bool anyTime = appendCase(sqlText, "trigger_time", &WarningChange::hasTriggerTime);
+    if (!anyTime) {
+        if (!anyMax && !anyMin) return;
+        sqlText.resize(sqlText.size() - 2);
+    }
+    sqlText += " WHERE orderId IN (";
+    for (std::size_t i = 0; i < merged.size(); ++i) {
+        sqlText += (i == 0) ? "?" : ", ?";
+    }
+    sqlText += ")";
+
+    std::unique_ptr<PreparedStatement> stmt(conn->prepareStatement(sqlText));
+    unsigned int col = 1;
+    if (anyMax) {
+        for (const auto& m : merged) {
+            if (!m.hasMaxPrice) continue;
+            stmt->setInt64(col++, m.orderId);
+            stmt->setDouble(col++, m.maxPrice);
+        }
+    }
+    if (anyMin) {
+        for (const auto& m : merged) {
+            if (!m.hasMinPrice) continue;
+            stmt->setInt64(col++, m.orderId);
+            stmt->setDouble(col++, m.minPrice);
+        }
+    }
+    if (anyTime) {
+        for (const auto& m : merged) {
+            if (!m.hasTriggerTime) continue;
+            stmt->setInt64(col++, m.orderId);
+            stmt->setString(col++, m.triggerTime);
+        }
+    }
+    for (const auto& m : merged) {
+        stmt->setInt64(col++, m.orderId);
+    }
+    stmt->execute();
+}
+
+WarningGroupCommit& WarningGroupCommit::Instance() {
+    static WarningGroupCommit instance;
+    return instance;
+}
+
+void WarningGroupCommit::Insert(const NewWarning& warning, Completion done) {
+    Request request;
+    request.isInsert = true;
+    request.warning = warning;
+    request.done = std::move(done);
+    Submit(std::move(request));
+}
+
+void WarningGroupCommit::Update(const WarningChange& change, Completion done) {
+    Request request;
+    request.change = change;
+    request.done = std::move(done);
+    Submit(std::move(request));
+}
+
+void WarningGroupCommit::Submit(Request&& request) {
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        pending.push_back(std::move(request));
+        if (flushing) return;
+        flushing = true;
+    }
+    PostBackgroundTask([this]() { Flush(); });
+}
+
+void WarningGroupCommit::Flush() {
+    std::vector<Request> group;
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        std::size_t n = (std::min)(pending.size(), WARNING_COMMIT_MAX_ROWS);
+        group.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            group.push_back(std::move(pending.front()));
+            pending.pop_front();
+        }
+    }
+
+    std::vector<Request*> members;
+    members.reserve(group.size());
+    for (Request& r : group) {
+        members.push_back(&r);
+    }
+    Execute(members);
+    for (Request& r : group) {
+        if (r.done) r.done(r.failed, r.orderId);
+    }
+
+    // 执行期间到达的请求组成下一组；重新投递而不是在本线程循环，让其他任务有机会执行
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        if (pending.empty()) {
+            flushing = false;
+            return;
+        }
+    }
+    PostBackgroundTask([this]() { Flush(); });
+}
+
+void WarningGroupCommit::Execute(const std::vector<Request*>& group) {
+    if (group.empty()) return;
+
+    std::vector<NewWarning> rows;
+    std::vector<Request*> inserted;
+    std::vector<WarningChange> changes;
+    for (Request* r : group) {
+        if (r->isInsert) {
+            rows.push_back(r->warning);
+            inserted.push_back(r);
+        }
+        else {
+            changes.push_back(r->change);
+        }
+    }
+
+    ConnectionLease conn;
+    try {
+        conn = DBManager::GetInstance()->Acquire();
+        if (group.size() > 1) {
+            conn->setAutoCommit(false);
+        }
+        // 全组的新增合并为一条多行 INSERT，修改合并为一条 UPDATE
+        if (!rows.empty()) {
+            std::vector<long long> ids = InsertWarnings(conn, rows);
+            for (std::size_t i = 0; i < inserted.size(); ++i) {
+                inserted[i]->orderId = ids[i];
+            }
+        }
+        UpdateWarnings(conn, changes);
+        if (group.size() > 1) {
+            conn->commit();
+        }
+        return;
+    }
+    catch (...) {
+        // 先归还连接：未提交的事务在归还时回滚（连接级错误时直接关闭），逐条重试不会等待它持有的行锁
+        conn.InvalidateOnConnectionError();
+        conn.Release();
+        if (group.size() == 1) {
+            group[0]->failed = true;
+            return;
+        }
+    }
+
+    // 整组失败（如某条的字段值不合法）：逐条重试，只让出错的请求失败
+    for (Request* r : group) {
+        Execute(std::vector<Request*>{ r });
+    }
+}
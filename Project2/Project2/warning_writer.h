@@ -0,0 +1,94 @@
+﻿#pragma once
+#ifndef WARNING_WRITER_H
+#define WARNING_WRITER_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "db_manager.h"
+
+// 组提交配置
+const std::size_t WARNING_COMMIT_MAX_ROWS = 200;    // 一组最多合并的请求数
+
+// 待插入的预警单（add_warning、batch 与组提交共用）
+struct NewWarning {
+    std::string account;
+    std::string symbol;
+    bool isTime = false;
+    double maxPrice = 0;
+    double minPrice = 0;
+    std::string triggerTime;
+};
+
+// 对一条预警单的修改（modify_warning），只写入 has* 为 true 的字段
+struct WarningChange {
+    long long orderId = 0;
+    bool hasMaxPrice = false;
+    bool hasMinPrice = false;
+    bool hasTriggerTime = false;
+    double maxPrice = 0;
+    double minPrice = 0;
+    std::string triggerTime;
+};
+
+// 插入一条预警单，返回其 ID（同一连接上的 LAST_INSERT_ID）
+long long InsertWarning(ConnectionLease& conn, const NewWarning& warning);
+
+// 插入多条预警单，按 rows 的顺序返回各自的 ID。
+// innodb_autoinc_lock_mode 为 0 或 1 时，行数已知的单条 INSERT 一次分配一段连续的自增值，
+// 相邻两行相差 auto_increment_increment：此时用一条多行 INSERT 写入，第 i 行的 ID 为
+// LAST_INSERT_ID + i * auto_increment_increment。为 2（交错模式）时不保证连续，退回逐行 INSERT。
+// 两个变量在进程内首次调用时读取，连接池的连接不修改会话级的 auto_increment_increment
+std::vector<long long> InsertWarnings(ConnectionLease& conn, const std::vector<NewWarning>& rows);
+
+// 用一条 UPDATE 执行多条修改（多条时按 orderId 以 CASE 选取各字段的新值），
+// 同一 orderId 的多次修改按顺序合并，后面的覆盖前面的
+void UpdateWarnings(ConnectionLease& conn, const std::vector<WarningChange>& changes);
+
+// 预警单写入的组提交（单例）：开盘时大量用户同时设置预警，
+// 每条 add_warning / modify_warning 各自提交一次事务会让吞吐受限于数据库的提交次数。
+// 写入请求排队后立即返回，不占用处理线程；执行器上同时只有一个刷新任务，
+// 每次取出已排队的请求（最多 WARNING_COMMIT_MAX_ROWS 条），用一条多行 INSERT 和一条 UPDATE
+// 在一个事务中写入（见 InsertWarnings），完成后逐条回调。
+// 刷新任务执行期间到达的请求组成下一组，没有固定的等待窗口：空闲时单条请求立即写入。
+// 整组失败时逐条重试，只让出错的请求失败
+class WarningGroupCommit {
+public:
+    // 写入完成回调（在执行器线程上调用）：failed 为 true 表示写入失败，orderId 只对插入有效
+    typedef std::function<void(bool failed, long long orderId)> Completion;
+
+    static WarningGroupCommit& Instance();
+
+    // 排队插入一条预警单
+    void Insert(const NewWarning& warning, Completion done);
+
+    // 排队修改一条预警单
+    void Update(const WarningChange& change, Completion done);
+
+private:
+    struct Request {
+        bool isInsert = false;
+        NewWarning warning;
+        WarningChange change;
+        Completion done;
+        long long orderId = 0;
+        bool failed = false;
+    };
+
+    WarningGroupCommit() : flushing(false) {}
+    WarningGroupCommit(const WarningGroupCommit&) = delete;
+    WarningGroupCommit& operator=(const WarningGroupCommit&) = delete;
+
+    void Submit(Request&& request);
+    void Flush();
+    void Execute(const std::vector<Request*>& group);
+
+    std::mutex mutex;
+    std::deque<Request> pending;    // 等待写入的请求
+    bool flushing;                  // 刷新任务已在执行器中排队或正在执行
+};
+
+#endif // WARNING_WRITER_H